@@ -0,0 +1,918 @@
+//headless benchmark for the decoder core, no geode needed
+//  gif_bench [--iterations N] [--indexed] [--max-size N] [--verify] [--variants] [--upload-queue MS] [--probe] [--write DIR] [file.gif | dir]...
+//without paths only the synthetic corpus runs, paths are added next to it
+#include "reference_compositor.hpp"
+#include "reference_kernels.hpp"
+
+#include <gifcore/Resampler.hpp>
+#include <gifcore/ShardedCache.hpp>
+#include <gifcore/TaskScheduler.hpp>
+#include <gifcore/UploadQueue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//minimal gif89a writer so the corpus doesnt have to live in the repo
+class GifWriter {
+public:
+    struct Color { uint8_t r, g, b; };
+
+    struct Frame {
+        int left = 0, top = 0, width = 0, height = 0;
+        std::vector<uint8_t> indices; //width * height, display order
+        int delay = 10; //1/100 s
+        int disposal = DISPOSE_DO_NOT;
+        int transparentIndex = NO_TRANSPARENT_COLOR;
+        std::vector<Color> localPalette; //empty = global
+        bool interlace = false;
+    };
+
+    std::vector<uint8_t> m_out;
+
+    void begin(int width, int height, std::vector<Color> const& palette) {
+        const char* sig = "GIF89a";
+        m_out.assign(sig, sig + 6);
+        u16(width);
+        u16(height);
+        int bits = paletteBits((int)palette.size());
+        m_out.push_back((uint8_t)(0x80 | ((bits - 1) << 4) | (bits - 1)));
+        m_out.push_back(0); //background
+        m_out.push_back(0); //aspect
+        writePalette(palette, bits);
+
+        //netscape loop forever
+        const uint8_t loop[] = { 0x21, 0xFF, 0x0B, 'N','E','T','S','C','A','P','E','2','.','0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+        m_out.insert(m_out.end(), loop, loop + sizeof(loop));
+        m_globalBits = bits;
+    }
+
+    void frame(Frame const& f) {
+        //graphics control extension
+        m_out.push_back(0x21);
+        m_out.push_back(0xF9);
+        m_out.push_back(4);
+        bool transparent = f.transparentIndex != NO_TRANSPARENT_COLOR;
+        m_out.push_back((uint8_t)((f.disposal & 7) << 2 | (transparent ? 1 : 0)));
+        u16(f.delay);
+        m_out.push_back(transparent ? (uint8_t)f.transparentIndex : 0);
+        m_out.push_back(0);
+
+        m_out.push_back(0x2C);
+        u16(f.left);
+        u16(f.top);
+        u16(f.width);
+        u16(f.height);
+        int bits = m_globalBits;
+        uint8_t packed = f.interlace ? 0x40 : 0;
+        if (!f.localPalette.empty()) {
+            bits = paletteBits((int)f.localPalette.size());
+            packed |= 0x80 | (bits - 1);
+        }
+        m_out.push_back(packed);
+        if (!f.localPalette.empty()) writePalette(f.localPalette, bits);
+
+        if (!f.interlace) {
+            compress(f.indices, std::max(2, bits));
+            return;
+        }
+
+        //stream stores rows pass by pass
+        std::vector<uint8_t> rows;
+        rows.reserve(f.indices.size());
+        const int starts[] = { 0, 4, 2, 1 };
+        const int steps[] = { 8, 8, 4, 2 };
+        for (int pass = 0; pass < 4; pass++) {
+            for (int y = starts[pass]; y < f.height; y += steps[pass]) {
+                rows.insert(rows.end(), f.indices.begin() + y * f.width, f.indices.begin() + (y + 1) * f.width);
+            }
+        }
+        compress(rows, std::max(2, bits));
+    }
+
+    void end() { m_out.push_back(0x3B); }
+
+private:
+    int m_globalBits = 8;
+
+    void u16(int v) {
+        m_out.push_back((uint8_t)(v & 0xFF));
+        m_out.push_back((uint8_t)(v >> 8));
+    }
+
+    static int paletteBits(int count) {
+        int bits = 1;
+        while ((1 << bits) < count) bits++;
+        return bits;
+    }
+
+    void writePalette(std::vector<Color> const& palette, int bits) {
+        for (int i = 0; i < (1 << bits); i++) {
+            Color c = i < (int)palette.size() ? palette[i] : Color{ 0, 0, 0 };
+            m_out.push_back(c.r);
+            m_out.push_back(c.g);
+            m_out.push_back(c.b);
+        }
+    }
+
+    //same code size schedule as giflib's encoder, so DGifSlurp reads it back exactly
+    void compress(std::vector<uint8_t> const& pixels, int minCodeSize) {
+        m_out.push_back((uint8_t)minCodeSize);
+
+        std::vector<uint8_t> data;
+        uint32_t bitBuffer = 0;
+        int bitCount = 0;
+
+        const int clearCode = 1 << minCodeSize;
+        const int eoiCode = clearCode + 1;
+        int nextCode = eoiCode + 1;
+        int codeSize = minCodeSize + 1;
+        std::unordered_map<uint32_t, int> dict;
+
+        auto output = [&](int code) {
+            bitBuffer |= (uint32_t)code << bitCount;
+            bitCount += codeSize;
+            while (bitCount >= 8) {
+                data.push_back((uint8_t)(bitBuffer & 0xFF));
+                bitBuffer >>= 8;
+                bitCount -= 8;
+            }
+            if (nextCode >= (1 << codeSize) and codeSize < 12) codeSize++;
+        };
+        auto reset = [&] {
+            dict.clear();
+            nextCode = eoiCode + 1;
+            codeSize = minCodeSize + 1;
+        };
+
+        output(clearCode);
+        if (!pixels.empty()) {
+            int prefix = pixels[0];
+            for (size_t i = 1; i < pixels.size(); i++) {
+                uint32_t key = (uint32_t)prefix << 8 | pixels[i];
+                auto it = dict.find(key);
+                if (it != dict.end()) {
+                    prefix = it->second;
+                    continue;
+                }
+                output(prefix);
+                if (nextCode >= 4095) {
+                    output(clearCode);
+                    reset();
+                }
+                else dict[key] = nextCode++;
+                prefix = pixels[i];
+            }
+            output(prefix);
+        }
+        output(eoiCode);
+        if (bitCount > 0) data.push_back((uint8_t)(bitBuffer & 0xFF));
+
+        for (size_t i = 0; i < data.size(); i += 255) {
+            size_t len = std::min<size_t>(255, data.size() - i);
+            m_out.push_back((uint8_t)len);
+            m_out.insert(m_out.end(), data.begin() + i, data.begin() + i + len);
+        }
+        m_out.push_back(0);
+    }
+};
+
+//deterministic so numbers are comparable between runs
+struct Rng {
+    uint32_t state;
+    uint32_t next() { state = state * 1664525u + 1013904223u; return state >> 8; }
+};
+
+static std::vector<GifWriter::Color> makePalette(int count, uint32_t seed) {
+    Rng rng{ seed };
+    std::vector<GifWriter::Color> palette(count);
+    for (auto& c : palette) c = { (uint8_t)rng.next(), (uint8_t)rng.next(), (uint8_t)rng.next() };
+    return palette;
+}
+
+//gradient bands with noisy blocks, compresses roughly like real content
+static std::vector<uint8_t> makeIndices(int width, int height, int colors, int frame, uint32_t seed, int reserved = -1) {
+    Rng rng{ seed + (uint32_t)frame * 7919u };
+    std::vector<uint8_t> indices((size_t)width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int v = (x / 6 + y / 6 + frame * 3) % colors;
+            if (((x / 8) * 31 + (y / 8) * 17 + frame) % 23 == 0) v = rng.next() % colors;
+            if (v == reserved) v = (v + 1) % colors;
+            indices[(size_t)y * width + x] = (uint8_t)v;
+        }
+    }
+    return indices;
+}
+
+struct CorpusEntry {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+//hold > 1 repeats every picture, like video exports at a lower frame rate
+static CorpusEntry makeFullFrames(const char* name, int width, int height, int colors, int frames, bool interlace, bool localPalettes, int hold = 1) {
+    GifWriter writer;
+    writer.begin(width, height, makePalette(colors, 1));
+    for (int i = 0; i < frames; i++) {
+        GifWriter::Frame f;
+        f.width = width;
+        f.height = height;
+        f.interlace = interlace;
+        f.indices = makeIndices(width, height, colors, i / hold, 42);
+        if (localPalettes) f.localPalette = makePalette(colors, 100 + i / hold);
+        writer.frame(f);
+    }
+    writer.end();
+    return { name, std::move(writer.m_out) };
+}
+
+//small sprite moving over a background, all disposal modes and transparent pixels
+static CorpusEntry makeTransparencyHeavy(const char* name, int width, int height, int frames) {
+    const int colors = 64;
+    const int transparent = colors - 1;
+    GifWriter writer;
+    writer.begin(width, height, makePalette(colors, 2));
+
+    GifWriter::Frame base;
+    base.width = width;
+    base.height = height;
+    base.transparentIndex = transparent;
+    base.indices = makeIndices(width, height, colors, 0, 7);
+    for (size_t i = 0; i < base.indices.size(); i += 3) base.indices[i] = transparent;
+    writer.frame(base);
+
+    const int sprite = std::min(64, std::min(width, height) / 2);
+    const int disposals[] = { DISPOSE_DO_NOT, DISPOSE_BACKGROUND, DISPOSE_PREVIOUS };
+    for (int i = 1; i < frames; i++) {
+        GifWriter::Frame f;
+        f.width = sprite;
+        f.height = sprite;
+        f.left = (i * 13) % (width - sprite);
+        f.top = (i * 7) % (height - sprite);
+        f.disposal = disposals[i % 3];
+        f.transparentIndex = transparent;
+        f.indices = makeIndices(sprite, sprite, colors, i, 9, transparent);
+        //round sprite, corners stay transparent
+        for (int y = 0; y < sprite; y++) {
+            for (int x = 0; x < sprite; x++) {
+                int dx = x - sprite / 2, dy = y - sprite / 2;
+                if (dx * dx + dy * dy > sprite * sprite / 4) f.indices[y * sprite + x] = transparent;
+            }
+        }
+        writer.frame(f);
+    }
+    writer.end();
+    return { name, std::move(writer.m_out) };
+}
+
+static std::vector<CorpusEntry> syntheticCorpus() {
+    std::vector<CorpusEntry> corpus;
+    corpus.push_back(makeFullFrames("static-512", 512, 512, 200, 1, false, false));
+    corpus.push_back(makeTransparencyHeavy("static-alpha-256", 256, 256, 1));
+    corpus.push_back(makeFullFrames("icon-32", 32, 32, 16, 12, false, false));
+    corpus.push_back(makeFullFrames("background-960x540", 960, 540, 256, 6, false, false));
+    corpus.push_back(makeFullFrames("many-frames-100", 100, 100, 64, 400, false, false));
+    corpus.push_back(makeFullFrames("interlaced-480x360", 480, 360, 128, 20, true, false));
+    corpus.push_back(makeFullFrames("local-palettes-320", 320, 240, 256, 30, false, true));
+    corpus.push_back(makeTransparencyHeavy("transparency-320", 320, 240, 90));
+    corpus.push_back(makeFullFrames("duplicates-320", 320, 240, 128, 60, false, false, 3));
+    return corpus;
+}
+
+static bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !out.empty();
+}
+
+struct Result {
+    int frames = 0;
+    int duplicates = 0; //frames a consumer would fold into the previous one
+    size_t canvasBytes = 0; //per frame
+    gifcore::StageTimings stages;
+    double staging = 0.0; //canvas snapshot copy
+    double convert = 0.0; //rgba8888 -> rgb888 for opaque gifs, rgba4444 otherwise (what the mod does for uploads), downscale included
+    double total = 0.0;
+};
+
+static bool runOnce(CorpusEntry const& entry, bool indexed, unsigned int maxSize, Result& result) {
+    gifcore::Decoder decoder;
+    decoder.m_requestIndexed = indexed;
+
+    std::vector<GifByteType> staging;
+    std::vector<uint16_t> converted;
+    std::vector<GifByteType> convertedRGB;
+    std::vector<GifByteType> scaled;
+    std::vector<GifByteType> scratch;
+    int frames = 0;
+    int duplicates = 0;
+
+    auto start = Clock::now();
+    bool success = decoder.decode(entry.data.data(), entry.data.size(), entry.name, [&](const gifcore::FrameInfo& info, const GifByteType* canvas) {
+        if (info.duplicate) duplicates++;
+        size_t pixelCount = (size_t)decoder.m_canvasWidth * decoder.m_canvasHeight;
+        size_t bytes = pixelCount * decoder.m_bytesPerPixel;
+
+        auto stagingStart = Clock::now();
+        staging.resize(bytes);
+        memcpy(staging.data(), canvas, bytes);
+        result.staging += secondsSince(stagingStart);
+
+        //--max-size shrinks the canvas first like CCGIFLoadOptions::maxTextureSize
+        auto convertStart = Clock::now();
+        int width = 0, height = 0;
+        gifcore::Resampler::targetSize(decoder.m_canvasWidth, decoder.m_canvasHeight, maxSize, 0.f, width, height);
+        if (width != decoder.m_canvasWidth or height != decoder.m_canvasHeight) {
+            scaled.resize((size_t)width * height * decoder.m_bytesPerPixel);
+            if (decoder.m_indexed) {
+                gifcore::Resampler::pointSample(canvas, decoder.m_canvasWidth, decoder.m_canvasHeight, 1, scaled.data(), width, height);
+            }
+            else {
+                scratch.resize(gifcore::Resampler::scratchBytes(decoder.m_canvasWidth, decoder.m_canvasHeight, width, height));
+                gifcore::Resampler::downscaleRGBA(canvas, decoder.m_canvasWidth, decoder.m_canvasHeight, scaled.data(), width, height, scratch.data());
+            }
+            canvas = scaled.data();
+            pixelCount = (size_t)width * height;
+        }
+        result.convert += secondsSince(convertStart);
+
+        if (!decoder.m_indexed) {
+            convertStart = Clock::now();
+            if (decoder.m_isOpaque) {
+                convertedRGB.resize(pixelCount * 3);
+                gifcore::PixelConverter::toRGB888(canvas, convertedRGB.data(), pixelCount);
+            }
+            else {
+                converted.resize(pixelCount);
+                gifcore::PixelConverter::toRGBA4444(canvas, converted.data(), pixelCount);
+            }
+            result.convert += secondsSince(convertStart);
+        }
+
+        frames++;
+        return true;
+    });
+    result.total += secondsSince(start);
+
+    if (!success) {
+        fprintf(stderr, "%s: %s\n", entry.name.c_str(), decoder.m_error.c_str());
+        return false;
+    }
+
+    result.frames = frames;
+    result.duplicates = duplicates;
+    result.canvasBytes = (size_t)decoder.m_canvasWidth * decoder.m_canvasHeight * decoder.m_bytesPerPixel;
+    result.stages.lzw += decoder.m_timings.lzw;
+    result.stages.disposal += decoder.m_timings.disposal;
+    result.stages.composite += decoder.m_timings.composite;
+    return true;
+}
+
+static double mbPerSecond(double bytes, double seconds) {
+    return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+//per pixel transparency + range test, what every frame went through before Compositor, kept as baseline
+static bool compositeBranchy(const GifByteType* raster, GifByteType* canvas, int canvasWidth, int left, int top, int width, int height,
+    const ColorMapObject* colorMap, int transparentColorIndex) {
+    unsigned int changed = 0;
+    for (int y = 0; y < height; y++) {
+        const GifByteType* rasterRow = raster + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            GifByteType colorIndex = rasterRow[x];
+            if (transparentColorIndex != NO_TRANSPARENT_COLOR and colorIndex == transparentColorIndex) continue;
+            if (colorIndex >= colorMap->ColorCount) continue;
+            const GifColorType& color = colorMap->Colors[colorIndex];
+            GifByteType* px = canvas + ((size_t)(top + y) * canvasWidth + left + x) * 4;
+            changed |= (px[0] ^ color.Red) | (px[1] ^ color.Green) | (px[2] ^ color.Blue) | (px[3] ^ 255);
+            px[0] = color.Red;
+            px[1] = color.Green;
+            px[2] = color.Blue;
+            px[3] = 255;
+        }
+    }
+    return changed != 0;
+}
+
+//every Compositor specialization on the same 1024x1024 raster, throughput in megapixels/s.
+//rows go through the resolved pointer one at a time, the way the decoder streams them.
+//keyed runs use a 128 color map with a transparent index, so about half the pixels keep the canvas
+static void runVariants(int iterations) {
+    const int size = 1024;
+    const int inset = 16; //frame sits inset from both sides, rows never span the whole canvas
+
+    std::vector<GifByteType> raster = makeIndices(size, size, 256, 0, 42);
+    std::vector<GifByteType> canvas((size_t)size * size * 4, 0);
+
+    auto palette = makePalette(256, 7);
+    std::vector<GifColorType> colors(256);
+    for (int i = 0; i < 256; i++) colors[i] = { palette[i].r, palette[i].g, palette[i].b };
+    ColorMapObject fullMap = { 256, 8, false, colors.data() };
+    ColorMapObject halfMap = { 128, 7, false, colors.data() };
+
+    GifByteType translation[256];
+    for (int i = 0; i < 256; i++) translation[i] = (GifByteType)i;
+
+    printf("%d iterations, %dx%d raster\n\n", iterations, size, size);
+    printf("%-28s %10s %10s\n", "variant", "ms/frame", "Mpix/s");
+
+    auto report = [&](const char* name, double seconds, size_t pixels) {
+        printf("%-28s %10.3f %10.1f\n", name, seconds / iterations * 1000.0,
+            seconds > 0.0 ? (double)pixels * iterations / 1e6 / seconds : 0.0);
+    };
+
+    for (int variant = 0; variant < 4; variant++) {
+        bool indexed = variant & 2, keyed = variant & 1;
+
+        gifcore::Compositor::Job job;
+        job.raster = raster.data();
+        job.canvas = canvas.data();
+        job.canvasWidth = size;
+        job.left = inset;
+        job.top = inset;
+        job.width = size - inset * 2;
+        job.height = size - inset * 2;
+        job.rasterStride = job.width;
+
+        const ColorMapObject* colorMap = keyed ? &halfMap : &fullMap;
+        int transparent = keyed ? 3 : NO_TRANSPARENT_COLOR;
+        gifcore::Compositor::Tables tables;
+        if (indexed) tables.buildIndexed(translation, colorMap->ColorCount, transparent, 255, true);
+        else tables.buildRGBA(colorMap, transparent, true);
+
+        auto traits = gifcore::Compositor::select(tables, indexed);
+        auto composite = gifcore::Compositor::resolve(traits);
+        gifcore::Compositor::Job row = job;
+        row.height = 1;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (int y = 0; y < job.height; y++) {
+                row.raster = job.raster + (size_t)y * job.rasterStride;
+                row.top = job.top + y;
+                composite(row, tables);
+            }
+        }
+        report(gifcore::Compositor::name(traits), secondsSince(start), (size_t)job.width * job.height);
+    }
+
+    for (bool keyed : { false, true }) {
+        const ColorMapObject* colorMap = keyed ? &halfMap : &fullMap;
+        int transparent = keyed ? 3 : NO_TRANSPARENT_COLOR;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; i++) compositeBranchy(raster.data(), canvas.data(), size, 0, 0, size, size, colorMap, transparent);
+        report(keyed ? "baseline per pixel, keyed" : "baseline per pixel", secondsSince(start), (size_t)size * size);
+    }
+}
+
+//preload of the whole corpus through gifcore::UploadQueue with a fake uploader (memcpy into a
+//"gpu" buffer), one drain per simulated tick. shows how many ticks it takes, how long the worst tick is
+//and when every gif had its first frame up
+static void runUploadQueue(std::vector<CorpusEntry> const& corpus, double budgetMs) {
+    struct Pending {
+        size_t gif;
+        size_t frame;
+    };
+    std::vector<gifcore::DecodedGIF> decoded(corpus.size());
+    gifcore::UploadQueue<Pending> queue;
+    queue.m_budget.seconds = budgetMs / 1000.0;
+
+    for (size_t i = 0; i < corpus.size(); i++) {
+        gifcore::Decoder decoder;
+        if (!decoder.decodeAll(corpus[i].data.data(), corpus[i].data.size(), corpus[i].name, decoded[i])) continue;
+        double neededAt = 0.0;
+        for (size_t f = 0; f < decoded[i].pixels.size(); f++) {
+            queue.push({ i, f }, 0, neededAt, decoded[i].pixels[f].size());
+            neededAt += decoded[i].frames[f].delay;
+        }
+    }
+
+    std::vector<GifByteType> gpu;
+    size_t firstFramesLeft = 0;
+    for (auto& gif : decoded) firstFramesLeft += gif.pixels.empty() ? 0 : 1;
+    size_t ticks = 0;
+    size_t firstFramesTick = 0;
+    while (!queue.empty()) {
+        ticks++;
+        queue.drain([&](Pending& pending) {
+            auto& pixels = decoded[pending.gif].pixels[pending.frame];
+            gpu.resize(std::max(gpu.size(), pixels.size()));
+            memcpy(gpu.data(), pixels.data(), pixels.size());
+            if (pending.frame == 0 and --firstFramesLeft == 0) firstFramesTick = ticks;
+            return gifcore::UploadResult::Uploaded;
+        });
+    }
+
+    auto& stats = queue.m_stats;
+    printf("%.2f ms budget: %zu frames, %.1f MB in %zu ticks (%zu over budget), worst tick %.3f ms, total %.3f ms\n",
+        budgetMs, stats.uploaded, stats.bytes / 1048576.0, ticks, stats.deferredDrains, stats.maxDrainSeconds * 1000.0, stats.seconds * 1000.0);
+    printf("first frame of all %zu gifs up by tick %zu\n", corpus.size(), firstFramesTick);
+}
+
+//the mods cache pattern from many threads at once: mostly lookups, some inserts over existing keys,
+//erases, prefix removals (removeGIF) and the odd purge and full walk. entries check their own key and count
+//themselves, a value read after its entry went away or freed twice shows up here (or in tsan, see README)
+struct StressEntry {
+    inline static std::atomic<int64_t> s_live = 0;
+    std::string key;
+    uint32_t magic = 0x61f5u;
+
+    StressEntry(std::string key) : key(std::move(key)) { s_live++; }
+    ~StressEntry() {
+        if (magic != 0x61f5u) abort();
+        magic = 0;
+        s_live--;
+    }
+};
+
+//what the cache manager was before: one map, one lock
+struct LockedCache {
+    using Pointer = std::shared_ptr<StressEntry>;
+    std::mutex mutex;
+    std::unordered_map<std::string, Pointer> map;
+
+    Pointer find(const std::string& key) {
+        std::lock_guard lock(mutex);
+        auto it = map.find(key);
+        return it != map.end() ? it->second : nullptr;
+    }
+    Pointer insert(const std::string& key, Pointer value) {
+        std::lock_guard lock(mutex);
+        std::swap(map[key], value);
+        return value;
+    }
+    Pointer erase(const std::string& key) {
+        std::lock_guard lock(mutex);
+        auto it = map.find(key);
+        if (it == map.end()) return nullptr;
+        Pointer value = std::move(it->second);
+        map.erase(it);
+        return value;
+    }
+    template <typename Pred>
+    std::vector<Pointer> eraseIf(Pred&& pred) {
+        std::vector<Pointer> removed;
+        std::lock_guard lock(mutex);
+        for (auto it = map.begin(); it != map.end();) {
+            if (pred(it->first, *it->second)) {
+                removed.push_back(std::move(it->second));
+                it = map.erase(it);
+            }
+            else ++it;
+        }
+        return removed;
+    }
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::lock_guard lock(mutex);
+        for (auto& [key, value] : map) fn(key, *value);
+    }
+};
+
+template <typename Cache>
+static bool stressCache(const char* name, int threadCount, int operations) {
+    Cache cache;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 256; i++) keys.push_back("gif" + std::to_string(i % 64) + ".gif_" + std::to_string(i));
+    std::atomic<size_t> hits = 0;
+    std::atomic<bool> bad = false;
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 random(t * 7919 + 1);
+            size_t localHits = 0;
+            for (int i = 0; i < operations; i++) {
+                const std::string& key = keys[random() % keys.size()];
+                unsigned int roll = random() % 1000;
+                if (roll < 850) {
+                    if (auto entry = cache.find(key)) {
+                        if (entry->key != key or entry->magic != 0x61f5u) bad = true;
+                        localHits++;
+                    }
+                }
+                else if (roll < 950) cache.insert(key, std::make_shared<StressEntry>(key));
+                else if (roll < 990) cache.erase(key);
+                else if (roll < 998) {
+                    std::string prefix = key.substr(0, key.find('_') + 1);
+                    cache.eraseIf([&](const std::string& entryKey, const StressEntry&) { return entryKey.find(prefix) == 0; });
+                }
+                else if (roll < 1000 or random() % 100) {
+                    cache.forEach([&](const std::string& entryKey, const StressEntry& entry) {
+                        if (entry.key != entryKey) bad = true;
+                    });
+                }
+                else cache.eraseIf([](const std::string&, const StressEntry&) { return true; });
+            }
+            hits += localHits;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = secondsSince(start);
+
+    cache.eraseIf([](const std::string&, const StressEntry&) { return true; });
+    bool ok = !bad and StressEntry::s_live == 0;
+    size_t total = (size_t)threadCount * operations;
+    printf("%-8s %2d threads: %zu ops in %.3f s, %.2f M ops/s, %.0f%% hits, %s\n", name, threadCount, total, seconds,
+        total / seconds / 1e6, 100.0 * hits / (total * 0.85), ok ? "ok" : "CORRUPTED");
+    return ok;
+}
+
+static bool runCacheStress(int threadCount, int iterations) {
+    bool ok = true;
+    int operations = 200000 * iterations;
+    for (int threads : { 1, threadCount }) {
+        ok &= stressCache<LockedCache>("1 lock", threads, operations);
+        ok &= stressCache<gifcore::ShardedCache<StressEntry>>("sharded", threads, operations);
+    }
+    return ok;
+}
+
+//the corpus through gifcore::TaskScheduler the way the mod runs background loads: every gif queued a few
+//times at mixed priorities, every other job cancelled once the first is done (menus closed before their gifs loaded),
+//frames of the rest shrunk to half size as split off tasks. checks the survivors and shows the order they finished in
+//Decoder::probe against a full decode of the same file: size, frames and duration have to agree
+static bool runProbe(std::vector<CorpusEntry> const& corpus, int iterations) {
+    printf("%d iterations, times are us per call\n\n", iterations);
+    printf("%-24s %9s %11s %6s %9s %5s | %9s %10s %8s\n", "file", "bytes", "size", "frames", "duration", "loop", "probe", "decode", "speedup");
+
+    int mismatches = 0;
+    for (auto& entry : corpus) {
+        gifcore::GIFInfo info;
+        bool probed = true;
+        auto probeStart = Clock::now();
+        for (int i = 0; i < iterations and probed; i++) {
+            gifcore::Decoder decoder;
+            probed = decoder.probe(entry.data.data(), entry.data.size(), entry.name, info);
+        }
+        double probeSeconds = secondsSince(probeStart);
+
+        int frames = 0;
+        float duration = 0.f;
+        GifWord width = 0, height = 0;
+        bool decoded = true;
+        auto decodeStart = Clock::now();
+        for (int i = 0; i < iterations and decoded; i++) {
+            gifcore::Decoder decoder;
+            frames = 0;
+            duration = 0.f;
+            decoded = decoder.decode(entry.data.data(), entry.data.size(), entry.name, [&](const gifcore::FrameInfo& frame, const GifByteType*) {
+                frames++;
+                duration += frame.delay;
+                return true;
+            });
+            width = decoder.m_canvasWidth;
+            height = decoder.m_canvasHeight;
+        }
+        double decodeSeconds = secondsSince(decodeStart);
+
+        bool agree = probed == decoded;
+        if (agree and decoded) {
+            agree = info.width == width and info.height == height and info.frameCount == frames and std::abs(info.duration - duration) < 1e-3f;
+        }
+        if (!agree) mismatches++;
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", info.width, info.height);
+        printf("%-24s %9zu %11s %6d %9.2f %5d | %9.1f %10.1f %7.0fx%s\n",
+            entry.name.c_str(), entry.data.size(), size, info.frameCount, info.duration, info.loopCount,
+            probeSeconds / iterations * 1e6, decodeSeconds / iterations * 1e6,
+            probeSeconds > 0.0 ? decodeSeconds / probeSeconds : 0.0,
+            agree ? "" : "  MISMATCH"
+        );
+    }
+    return mismatches == 0;
+}
+
+static bool runScheduler(std::vector<CorpusEntry> const& corpus, int threads, int iterations) {
+    struct Job {
+        const CorpusEntry* entry = nullptr;
+        std::shared_ptr<gifcore::JobControl> control = std::make_shared<gifcore::JobControl>();
+        gifcore::DecodedGIF decoded;
+        bool success = false;
+        bool stoppedEarly = false;
+        std::atomic<size_t> framesLeft = 0;
+        int finishedAs = -1;
+    };
+
+    gifcore::TaskScheduler scheduler(threads);
+    std::atomic<int> finished = 0;
+    std::vector<std::unique_ptr<Job>> jobs;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (auto& entry : corpus) {
+            auto& job = *jobs.emplace_back(std::make_unique<Job>());
+            job.entry = &entry;
+            job.control->priority = (int)(jobs.size() % 3);
+            scheduler.submit([&scheduler, &finished, &job] {
+                gifcore::Decoder decoder;
+                decoder.m_cancel = &job.control->cancelled;
+                job.success = decoder.decodeAll(job.entry->data.data(), job.entry->data.size(), job.entry->name, job.decoded);
+                job.stoppedEarly = decoder.m_cancelled;
+                if (!job.success) {
+                    job.finishedAs = finished++;
+                    return;
+                }
+                int width = std::max(1, job.decoded.canvasWidth / 2), height = std::max(1, job.decoded.canvasHeight / 2);
+                job.framesLeft = job.decoded.pixels.size();
+                for (size_t f = 0; f < job.decoded.pixels.size(); f++) {
+                    scheduler.spawn([&finished, &job, f, width, height] {
+                        auto& pixels = job.decoded.pixels[f];
+                        int bytesPerPixel = job.decoded.indexed ? 1 : 4;
+                        std::vector<GifByteType> scaled((size_t)width * height * bytesPerPixel);
+                        std::vector<GifByteType> scratch(gifcore::Resampler::scratchBytes(job.decoded.canvasWidth, job.decoded.canvasHeight, width, height));
+                        gifcore::Resampler::downscaleRGBA(pixels.data(), job.decoded.canvasWidth, job.decoded.canvasHeight, scaled.data(), width, height, scratch.data());
+                        pixels = std::move(scaled);
+                        if (--job.framesLeft == 0) job.finishedAs = finished++;
+                    });
+                }
+            }, job.control);
+        }
+    }
+    //once the first one is through some are running, they have to stop midway
+    while (finished == 0) std::this_thread::yield();
+    for (size_t i = 0; i < jobs.size(); i += 2) jobs[i]->control->cancelled = true;
+    scheduler.wait();
+    double seconds = secondsSince(start);
+
+    bool ok = true;
+    size_t stoppedEarly = 0;
+    double rankSum[3] = {};
+    size_t rankCount[3] = {};
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto& job = *jobs[i];
+        stoppedEarly += job.stoppedEarly;
+        if (i % 2 == 0) continue;
+        size_t expected = (size_t)std::max(1, job.decoded.canvasWidth / 2) * std::max(1, job.decoded.canvasHeight / 2) * 4;
+        bool shrunk = job.success and std::all_of(job.decoded.pixels.begin(), job.decoded.pixels.end(), [&](auto& pixels) { return pixels.size() == expected; });
+        if (!shrunk or job.finishedAs < 0) {
+            printf("%s: %s\n", job.entry->name.c_str(), job.success ? "frames not shrunk" : "decode failed");
+            ok = false;
+        }
+        int priority = job.control->priority;
+        rankSum[priority] += job.finishedAs;
+        rankCount[priority]++;
+    }
+
+    auto stats = scheduler.stats();
+    printf("%zu workers, %zu jobs (half cancelled) in %.3f s\n", scheduler.workerCount(), jobs.size(), seconds);
+    printf("tasks: %zu run, %zu split off, %zu stolen, %zu dropped before start, %zu decodes stopped midway\n",
+        stats.executed, stats.spawned, stats.stolen, stats.cancelled, stoppedEarly);
+    printf("mean finish position by priority: 2 -> %.1f, 1 -> %.1f, 0 -> %.1f\n",
+        rankSum[2] / std::max<size_t>(1, rankCount[2]), rankSum[1] / std::max<size_t>(1, rankCount[1]), rankSum[0] / std::max<size_t>(1, rankCount[0]));
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 5;
+    bool indexed = false;
+    bool verify = false;
+    bool variants = false;
+    bool probe = false;
+    unsigned int maxSize = 0;
+    double uploadBudgetMs = 0.0;
+    int stressThreads = 0;
+    int schedulerThreads = 0;
+    std::string writeDir;
+    std::vector<std::filesystem::path> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" and i + 1 < argc) iterations = std::max(1, atoi(argv[++i]));
+        else if (arg == "--indexed") indexed = true;
+        else if (arg == "--max-size" and i + 1 < argc) maxSize = (unsigned int)std::max(0, atoi(argv[++i]));
+        else if (arg == "--verify") verify = true;
+        else if (arg == "--variants") variants = true;
+        else if (arg == "--probe") probe = true;
+        else if (arg == "--upload-queue" and i + 1 < argc) uploadBudgetMs = std::max(0.001, atof(argv[++i]));
+        else if (arg == "--cache-stress" and i + 1 < argc) stressThreads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--scheduler" and i + 1 < argc) schedulerThreads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--write" and i + 1 < argc) writeDir = argv[++i];
+        else if (arg == "--help" or arg == "-h") {
+            printf("usage: %s [--iterations N] [--indexed] [--max-size N] [--verify] [--variants] [--upload-queue MS] [--probe] [--cache-stress THREADS] [--scheduler THREADS] [--write DIR] [file.gif | dir]...\n", argv[0]);
+            return 0;
+        }
+        else paths.emplace_back(arg);
+    }
+
+    if (variants) {
+        runVariants(iterations);
+        return 0;
+    }
+
+    if (stressThreads > 0) return runCacheStress(stressThreads, iterations) ? 0 : 1;
+
+    std::vector<CorpusEntry> corpus = syntheticCorpus();
+
+    if (!writeDir.empty()) {
+        std::filesystem::create_directories(writeDir);
+        for (auto& entry : corpus) {
+            std::ofstream file(std::filesystem::path(writeDir) / (entry.name + ".gif"), std::ios::binary);
+            file.write((const char*)entry.data.data(), entry.data.size());
+        }
+    }
+
+    for (auto& path : paths) {
+        std::vector<std::filesystem::path> files;
+        if (std::filesystem::is_directory(path)) {
+            for (auto& file : std::filesystem::recursive_directory_iterator(path)) {
+                auto ext = file.path().extension().string();
+                std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+                if (file.is_regular_file() and ext == ".gif") files.push_back(file.path());
+            }
+            std::sort(files.begin(), files.end());
+        }
+        else files.push_back(path);
+
+        for (auto& file : files) {
+            CorpusEntry entry{ file.filename().string(), {} };
+            if (!readFile(file, entry.data)) {
+                fprintf(stderr, "Failed to read %s\n", file.string().c_str());
+                continue;
+            }
+            corpus.push_back(std::move(entry));
+        }
+    }
+
+    if (uploadBudgetMs > 0.0) {
+        runUploadQueue(corpus, uploadBudgetMs);
+        return 0;
+    }
+
+    if (schedulerThreads > 0) return runScheduler(corpus, schedulerThreads, iterations) ? 0 : 1;
+    if (probe) return runProbe(corpus, iterations) ? 0 : 1;
+
+    //differential check against the reference compositor and kernels instead of timing
+    if (verify) {
+        int mismatches = 0;
+        std::string converter = reference::checkPixelConverter();
+        printf("%-24s %-7s %s\n", "pixel-converter", "kernels", converter.empty() ? "ok" : converter.c_str());
+        if (!converter.empty()) mismatches++;
+        std::string resampler = reference::checkResampler();
+        printf("%-24s %-7s %s\n", "resampler", "kernels", resampler.empty() ? "ok" : resampler.c_str());
+        if (!resampler.empty()) mismatches++;
+        for (auto& entry : corpus) {
+            for (bool indexedMode : { false, true }) {
+                std::string mismatch = reference::compare(entry.data.data(), entry.data.size(), indexedMode);
+                printf("%-24s %-7s %s\n", entry.name.c_str(), indexedMode ? "indexed" : "rgba", mismatch.empty() ? "ok" : mismatch.c_str());
+                if (!mismatch.empty()) mismatches++;
+            }
+        }
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    printf("%d iterations, %s canvas, times are ms per decode\n\n", iterations, indexed ? "indexed" : "rgba");
+    printf("%-24s %9s %6s %5s | %8s %8s %8s %8s %8s | %8s %9s %9s\n",
+        "file", "bytes", "frames", "dups", "lzw", "dispose", "compose", "staging", "convert", "total", "lzw MB/s", "frames/s");
+
+    int failures = 0;
+    for (auto& entry : corpus) {
+        Result result;
+        bool ok = true;
+        for (int i = 0; i < iterations and ok; i++) ok = runOnce(entry, indexed, maxSize, result);
+        if (!ok) {
+            failures++;
+            continue;
+        }
+
+        double n = iterations;
+        printf("%-24s %9zu %6d %5d | %8.3f %8.3f %8.3f %8.3f %8.3f | %8.3f %9.1f %9.0f\n",
+            entry.name.c_str(), entry.data.size(), result.frames, result.duplicates,
+            result.stages.lzw / n * 1000.0,
+            result.stages.disposal / n * 1000.0,
+            result.stages.composite / n * 1000.0,
+            result.staging / n * 1000.0,
+            result.convert / n * 1000.0,
+            result.total / n * 1000.0,
+            mbPerSecond((double)entry.data.size() * n, result.stages.lzw),
+            result.total > 0.0 ? result.frames * n / result.total : 0.0
+        );
+        printf("%-24s %9s %6s %5s | %8s %8s %8.1f %8.1f %8.1f | (canvas MB/s)\n", "", "", "", "", "", "",
+            mbPerSecond((double)result.canvasBytes * result.frames * n, result.stages.composite),
+            mbPerSecond((double)result.canvasBytes * result.frames * n, result.staging),
+            mbPerSecond((double)result.canvasBytes * result.frames * n, result.convert)
+        );
+    }
+
+    return failures == 0 ? 0 : 1;
+}
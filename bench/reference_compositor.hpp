@@ -0,0 +1,189 @@
+#pragma once
+
+//deliberately naive compositor used as ground truth for gifcore::Decoder:
+//full canvas snapshots, per pixel bounds checks, rgba only. slow on purpose, keep it obvious
+#include <gifcore/Decoder.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace reference {
+
+struct Frame {
+    float delay = 0.1f;
+    int disposal = DISPOSE_DO_NOT;
+    std::vector<GifByteType> rgba;
+};
+
+struct Result {
+    bool success = false;
+    GifWord width = 0;
+    GifWord height = 0;
+    std::vector<Frame> frames;
+};
+
+inline Result decode(const unsigned char* data, size_t size, size_t maxCanvasPixels) {
+    struct Reader {
+        const unsigned char* data;
+        size_t size;
+        size_t position;
+    };
+    Reader reader = { data, size, 0 };
+
+    Result result;
+    int error = 0;
+    GifFileType* gif = DGifOpen(&reader, [](GifFileType* gif, GifByteType* buf, int count) {
+        auto reader = static_cast<Reader*>(gif->UserData);
+        size_t left = reader->size - reader->position;
+        size_t n = count < 0 ? 0 : std::min<size_t>((size_t)count, left);
+        memcpy(buf, reader->data + reader->position, n);
+        reader->position += n;
+        return (int)n;
+    }, &error);
+    if (!gif) return result;
+
+    const GifWord width = gif->SWidth;
+    const GifWord height = gif->SHeight;
+    if (width <= 0 or height <= 0 or (size_t)width * height > maxCanvasPixels
+        or DGifSlurp(gif) == GIF_ERROR or gif->ImageCount <= 0) {
+        DGifCloseFile(gif);
+        return result;
+    }
+
+    result.width = width;
+    result.height = height;
+
+    std::vector<GifByteType> canvas((size_t)width * height * 4, 0);
+    std::vector<GifByteType> snapshot;
+    bool havePrev = false;
+    GifImageDesc prevDesc = {};
+    int prevDisposal = DISPOSE_DO_NOT;
+
+    auto inCanvas = [&](int x, int y) { return x >= 0 and y >= 0 and x < width and y < height; };
+
+    for (int i = 0; i < gif->ImageCount; i++) {
+        SavedImage& image = gif->SavedImages[i];
+        GifImageDesc& desc = image.ImageDesc;
+        ColorMapObject* colorMap = desc.ColorMap ? desc.ColorMap : gif->SColorMap;
+        if (!image.RasterBits or !colorMap) continue;
+
+        //frames that dont touch the canvas at all are dropped
+        bool visible = desc.Left < width and desc.Top < height and desc.Width > 0 and desc.Height > 0;
+        if (!visible) continue;
+
+        Frame frame;
+        int transparent = NO_TRANSPARENT_COLOR;
+        GraphicsControlBlock gcb;
+        if (DGifSavedExtensionToGCB(gif, i, &gcb) == GIF_OK) {
+            frame.delay = gcb.DelayTime > 0 ? gcb.DelayTime / 100.0f : 0.1f;
+            frame.disposal = gcb.DisposalMode;
+            transparent = gcb.TransparentColor;
+        }
+
+        if (havePrev and prevDisposal == DISPOSE_BACKGROUND) {
+            for (int y = prevDesc.Top; y < prevDesc.Top + prevDesc.Height; y++) {
+                for (int x = prevDesc.Left; x < prevDesc.Left + prevDesc.Width; x++) {
+                    if (inCanvas(x, y)) memset(&canvas[((size_t)y * width + x) * 4], 0, 4);
+                }
+            }
+        }
+        else if (havePrev and prevDisposal == DISPOSE_PREVIOUS) {
+            canvas = snapshot;
+        }
+
+        if (frame.disposal == DISPOSE_PREVIOUS) snapshot = canvas;
+
+        for (int y = 0; y < desc.Height; y++) {
+            for (int x = 0; x < desc.Width; x++) {
+                int cx = desc.Left + x, cy = desc.Top + y;
+                if (!inCanvas(cx, cy)) continue;
+                int index = image.RasterBits[(size_t)y * desc.Width + x];
+                if (index == transparent or index >= colorMap->ColorCount) continue;
+                GifByteType* px = &canvas[((size_t)cy * width + cx) * 4];
+                px[0] = colorMap->Colors[index].Red;
+                px[1] = colorMap->Colors[index].Green;
+                px[2] = colorMap->Colors[index].Blue;
+                px[3] = 255;
+            }
+        }
+
+        frame.rgba = canvas;
+        result.frames.push_back(std::move(frame));
+        havePrev = true;
+        prevDesc = desc;
+        prevDisposal = result.frames.back().disposal;
+    }
+
+    DGifCloseFile(gif);
+    result.success = !result.frames.empty();
+    return result;
+}
+
+//runs gifcore::Decoder and the reference on the same bytes,
+//returns empty string when they agree, else what differed first
+inline std::string compare(const unsigned char* data, size_t size, bool indexed, size_t maxCanvasPixels = 4096 * 4096) {
+    Result expected = decode(data, size, maxCanvasPixels);
+
+    gifcore::Decoder decoder;
+    decoder.m_requestIndexed = indexed;
+    decoder.m_maxCanvasPixels = maxCanvasPixels;
+
+    std::string mismatch;
+    size_t frameIndex = 0;
+    std::vector<GifByteType> rgba;
+    bool success = decoder.decode(data, size, "compare", [&](const gifcore::FrameInfo& info, const GifByteType* canvas) {
+        if (!mismatch.empty()) return true;
+        if (frameIndex >= expected.frames.size()) {
+            mismatch = "decoder produced more frames than reference (" + std::to_string(expected.frames.size()) + ")";
+            return true;
+        }
+
+        size_t pixelCount = (size_t)decoder.m_canvasWidth * decoder.m_canvasHeight;
+        const GifByteType* pixels = canvas;
+        if (decoder.m_indexed) {
+            rgba.resize(pixelCount * 4);
+            for (size_t i = 0; i < pixelCount; i++) memcpy(&rgba[i * 4], &decoder.m_palette.colors[canvas[i] * 4], 4);
+            pixels = rgba.data();
+        }
+
+        auto& frame = expected.frames[frameIndex];
+        char buf[160];
+        if (info.delay != frame.delay or info.disposalMethod != frame.disposal) {
+            snprintf(buf, sizeof(buf), "frame %zu: delay/disposal %g/%d, reference %g/%d",
+                frameIndex, info.delay, info.disposalMethod, frame.delay, frame.disposal);
+            mismatch = buf;
+        }
+        else if (info.duplicate and (frameIndex == 0 or frame.rgba != expected.frames[frameIndex - 1].rgba)) {
+            snprintf(buf, sizeof(buf), "frame %zu: flagged duplicate but differs from the frame before", frameIndex);
+            mismatch = buf;
+        }
+        else if (memcmp(pixels, frame.rgba.data(), pixelCount * 4) != 0) {
+            size_t i = 0;
+            while (memcmp(pixels + i * 4, &frame.rgba[i * 4], 4) == 0) i++;
+            snprintf(buf, sizeof(buf), "frame %zu%s: pixel (%zu,%zu) is %02x%02x%02x%02x, reference %02x%02x%02x%02x",
+                frameIndex, decoder.m_indexed ? " (indexed)" : "", i % decoder.m_canvasWidth, i / decoder.m_canvasWidth,
+                pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2], pixels[i * 4 + 3],
+                frame.rgba[i * 4], frame.rgba[i * 4 + 1], frame.rgba[i * 4 + 2], frame.rgba[i * 4 + 3]);
+            mismatch = buf;
+        }
+        frameIndex++;
+        return true;
+    });
+
+    //decoder streams frames out before it reaches broken lzw data further in, slurp fails up front.
+    //both failing is agreement, whatever went out before is discarded by every consumer
+    if (!success and !expected.success) return "";
+    if (!mismatch.empty()) return mismatch;
+    if (success != expected.success) {
+        return std::string("decoder ") + (success ? "succeeded" : "failed (" + decoder.m_error + ")")
+            + " but reference " + (expected.success ? "succeeded" : "failed");
+    }
+    if (success and frameIndex != expected.frames.size()) {
+        return "decoder produced " + std::to_string(frameIndex) + " frames, reference " + std::to_string(expected.frames.size());
+    }
+    return "";
+}
+
+}
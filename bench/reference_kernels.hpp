@@ -0,0 +1,392 @@
+#pragma once
+
+//naive ground truth for the gifcore pixel kernels, checked by gif_bench --verify.
+//every check returns an empty string or what went wrong first
+#include <gifcore/PixelConverter.hpp>
+#include <gifcore/Resampler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace reference {
+
+//what the gpu reads back from an n bit channel: q * 255 / max, rounded
+inline int expandChannel(int q, int bits) {
+    int max = (1 << bits) - 1;
+    return (int)std::lround(q * 255.0 / max);
+}
+
+struct PackedLayout {
+    const char* name;
+    int bits[4]; //r g b a, 0 = dropped
+    int shift[4];
+    void (*convert)(const GifByteType*, uint16_t*, size_t);
+};
+
+inline const PackedLayout* packedLayouts() {
+    static const PackedLayout layouts[] = {
+        { "rgba4444", { 4, 4, 4, 4 }, { 12, 8, 4, 0 }, gifcore::PixelConverter::toRGBA4444 },
+        { "rgb5a1", { 5, 5, 5, 1 }, { 11, 6, 1, 0 }, gifcore::PixelConverter::toRGB5A1 },
+        { "rgb565", { 5, 6, 5, 0 }, { 11, 5, 0, 0 }, gifcore::PixelConverter::toRGB565 },
+        { nullptr, {}, {}, nullptr },
+    };
+    return layouts;
+}
+
+//color goes through the converter and back the way the gpu expands it, alpha 255
+inline bool survives(PackedLayout const& layout, GifColorType const& c) {
+    GifByteType pixel[4] = { c.Red, c.Green, c.Blue, 255 };
+    uint16_t packed = 0;
+    layout.convert(pixel, &packed, 1);
+    for (int channel = 0; channel < 3; channel++) {
+        int bits = layout.bits[channel];
+        int q = (packed >> layout.shift[channel]) & ((1 << bits) - 1);
+        if (expandChannel(q, bits) != pixel[channel]) return false;
+    }
+    return true;
+}
+
+inline std::string checkPixelConverter() {
+    using gifcore::PixelConverter;
+    char buf[192];
+
+    //every 8 bit value through every channel alone, the other channels must stay 0
+    for (auto layout = packedLayouts(); layout->name; layout++) {
+        for (int channel = 0; channel < 4; channel++) {
+            for (int v = 0; v < 256; v++) {
+                GifByteType pixel[4] = {};
+                pixel[channel] = (GifByteType)v;
+                uint16_t packed = 0;
+                layout->convert(pixel, &packed, 1);
+                int bits = layout->bits[channel];
+                uint16_t expected = bits ? (uint16_t)((v >> (8 - bits)) << layout->shift[channel]) : 0;
+                if (packed != expected) {
+                    snprintf(buf, sizeof(buf), "%s channel %d value %d packed to 0x%04x, expected 0x%04x", layout->name, channel, v, packed, expected);
+                    return buf;
+                }
+            }
+        }
+    }
+
+    std::vector<GifByteType> rgba(256 * 4);
+    std::vector<GifByteType> rgb(256 * 3);
+    for (int v = 0; v < 256; v++) {
+        for (int channel = 0; channel < 4; channel++) rgba[v * 4 + channel] = (GifByteType)(v + channel * 64);
+    }
+    PixelConverter::toRGB888(rgba.data(), rgb.data(), 256);
+    for (int v = 0; v < 256; v++) {
+        for (int channel = 0; channel < 3; channel++) {
+            if (rgb[v * 3 + channel] != rgba[v * 4 + channel]) {
+                snprintf(buf, sizeof(buf), "rgb888 pixel %d channel %d is %d, expected %d", v, channel, rgb[v * 3 + channel], rgba[v * 4 + channel]);
+                return buf;
+            }
+        }
+    }
+
+    //fitsN against a real round trip through n bits
+    for (int v = 0; v < 256; v++) {
+        bool fits[3] = { PixelConverter::fits4((GifByteType)v), PixelConverter::fits5((GifByteType)v), PixelConverter::fits6((GifByteType)v) };
+        for (int bits = 4; bits <= 6; bits++) {
+            bool expected = expandChannel(v >> (8 - bits), bits) == v;
+            if (fits[bits - 4] != expected) {
+                snprintf(buf, sizeof(buf), "fits%d(%d) is %d, expanding it back gives %s", bits, v, fits[bits - 4], expected ? "the same byte" : "another byte");
+                return buf;
+            }
+        }
+    }
+
+    //Auto: 16 bit exactly when every palette color survives that format. palettes are drawn from values
+    //exact in 4, 5 or 6 bits (or anything), sometimes with one stray color so both answers come up
+    std::mt19937 rng(1234);
+    auto layouts = packedLayouts();
+    auto& rgba4444 = layouts[0];
+    auto& rgb5a1 = layouts[1];
+    auto& rgb565 = layouts[2];
+    for (int round = 0; round < 2000; round++) {
+        int size = 1 << (1 + rng() % 8);
+        int kind = rng() % 4;
+        std::vector<GifColorType> colors(size);
+        for (int i = 0; i < size; i++) {
+            GifByteType values[3];
+            for (int channel = 0; channel < 3; channel++) {
+                int bits = kind == 0 ? 4 : kind == 1 ? 5 : kind == 2 ? (channel == 1 ? 6 : 5) : 8;
+                values[channel] = (GifByteType)expandChannel(rng() % (1 << bits), bits);
+            }
+            colors[i] = { values[0], values[1], values[2] };
+        }
+        if (rng() % 3 == 0) colors[rng() % size].Green = (GifByteType)(rng() % 256);
+
+        ColorMapObject* map = GifMakeMapObject(size, colors.data());
+        PixelConverter::PaletteFit fit;
+        fit.add(map);
+        GifFreeMapObject(map);
+
+        auto lossless = [&](PackedLayout const& layout) {
+            for (auto& c : colors) {
+                if (!survives(layout, c)) return false;
+            }
+            return true;
+        };
+        bool exact4444 = lossless(rgba4444), exact5a1 = lossless(rgb5a1), exact565 = lossless(rgb565);
+        if (fit.rgba4444 != exact4444 or fit.rgb5a1 != exact5a1 or fit.rgb565 != exact565) {
+            snprintf(buf, sizeof(buf), "palette fit %d%d%d (4444, 5a1, 565), round trip says %d%d%d",
+                fit.rgba4444, fit.rgb5a1, fit.rgb565, exact4444, exact5a1, exact565);
+            return buf;
+        }
+
+        for (bool isOpaque : { true, false }) {
+            auto format = PixelConverter::autoFormat(isOpaque, fit);
+            bool sixteen = format != PixelConverter::Format::RGBA8888 and format != PixelConverter::Format::RGB888;
+            //565 has no alpha, only opaque gifs can use it
+            bool expected = exact4444 or exact5a1 or (isOpaque and exact565);
+            bool chosenExact = format == PixelConverter::Format::RGBA4444 ? exact4444
+                : format == PixelConverter::Format::RGB5A1 ? exact5a1
+                : format == PixelConverter::Format::RGB565 ? exact565 and isOpaque
+                : true;
+            if (sixteen != expected or !chosenExact or (!isOpaque and format == PixelConverter::Format::RGB888)) {
+                snprintf(buf, sizeof(buf), "auto picked format %d for a %s palette of %d colors that fits %d%d%d (4444, 5a1, 565)",
+                    (int)format, isOpaque ? "opaque" : "transparent", size, exact4444, exact5a1, exact565);
+                return buf;
+            }
+        }
+    }
+    return "";
+}
+
+
+//rgba with straight color, what the resampler should produce before rounding
+struct FloatImage {
+    int width = 0, height = 0;
+    std::vector<double> pixels;
+};
+
+//every fx x fy block (partial at the edges) averaged with alpha as weight, in doubles
+inline FloatImage boxReference(const GifByteType* src, int width, int height, int fx, int fy) {
+    FloatImage out;
+    out.width = (width + fx - 1) / fx;
+    out.height = (height + fy - 1) / fy;
+    out.pixels.assign((size_t)out.width * out.height * 4, 0.0);
+    for (int dy = 0; dy < out.height; dy++) {
+        for (int dx = 0; dx < out.width; dx++) {
+            double sum[4] = {};
+            int count = 0;
+            for (int y = dy * fy; y < std::min(dy * fy + fy, height); y++) {
+                for (int x = dx * fx; x < std::min(dx * fx + fx, width); x++) {
+                    const GifByteType* p = src + ((size_t)y * width + x) * 4;
+                    for (int c = 0; c < 3; c++) sum[c] += (double)p[c] * p[3];
+                    sum[3] += p[3];
+                    count++;
+                }
+            }
+            double* o = &out.pixels[((size_t)dy * out.width + dx) * 4];
+            for (int c = 0; c < 3 and sum[3] > 0.0; c++) o[c] = sum[c] / sum[3];
+            o[3] = sum[3] / count;
+        }
+    }
+    return out;
+}
+
+//2x2 taps at pixel centers with exact weights, premultiplied
+inline FloatImage bilinearReference(const GifByteType* src, int width, int height, int dstWidth, int dstHeight) {
+    FloatImage out;
+    out.width = dstWidth;
+    out.height = dstHeight;
+    out.pixels.assign((size_t)dstWidth * dstHeight * 4, 0.0);
+    auto tap = [](int d, int size, int dstSize, int& i0, int& i1, double& t) {
+        double pos = std::max(0.0, (d + 0.5) * size / dstSize - 0.5);
+        i0 = std::min((int)pos, size - 1);
+        i1 = std::min(i0 + 1, size - 1);
+        t = pos - i0;
+    };
+    for (int dy = 0; dy < dstHeight; dy++) {
+        int y[2];
+        double ty;
+        tap(dy, height, dstHeight, y[0], y[1], ty);
+        for (int dx = 0; dx < dstWidth; dx++) {
+            int x[2];
+            double tx;
+            tap(dx, width, dstWidth, x[0], x[1], tx);
+            double sum[4] = {};
+            for (int j = 0; j < 2; j++) {
+                for (int i = 0; i < 2; i++) {
+                    const GifByteType* p = src + ((size_t)y[j] * width + x[i]) * 4;
+                    double w = (i ? tx : 1.0 - tx) * (j ? ty : 1.0 - ty) * p[3];
+                    for (int c = 0; c < 3; c++) sum[c] += w * p[c];
+                    sum[3] += w;
+                }
+            }
+            double* o = &out.pixels[((size_t)dy * dstWidth + dx) * 4];
+            for (int c = 0; c < 3 and sum[3] > 0.0; c++) o[c] = sum[c] / sum[3];
+            o[3] = sum[3];
+        }
+    }
+    return out;
+}
+
+inline std::vector<GifByteType> rounded(FloatImage const& image) {
+    std::vector<GifByteType> out(image.pixels.size());
+    for (size_t i = 0; i < out.size(); i++) out[i] = (GifByteType)std::lround(image.pixels[i]);
+    return out;
+}
+
+//box sums are exact, only the final division may round the other way: alpha has to match,
+//color within 1 wherever something is visible. bilinear weights are 8 bit fixed point, so it is
+//compared premultiplied (color * alpha / 255) with tolerance, a color under almost no alpha says nothing
+inline std::string compareResampled(const char* what, std::vector<GifByteType> const& out, FloatImage const& expected, bool premultiplied, double tolerance) {
+    char buf[192];
+    for (size_t i = 0; i < out.size(); i += 4) {
+        const double* e = &expected.pixels[i];
+        const GifByteType* o = &out[i];
+        double worst = 0.0;
+        if (premultiplied) {
+            worst = std::abs(o[3] - e[3]);
+            for (int c = 0; c < 3; c++) worst = std::max(worst, std::abs(o[c] * o[3] / 255.0 - e[c] * e[3] / 255.0));
+        }
+        else {
+            if (o[3] != std::lround(e[3])) worst = tolerance + 1.0;
+            for (int c = 0; c < 3 and e[3] > 0.0; c++) worst = std::max(worst, std::abs(o[c] - e[c]));
+        }
+        if (worst > tolerance or (e[3] == 0.0 and (o[0] or o[1] or o[2] or o[3]))) {
+            int pixel = (int)(i / 4);
+            snprintf(buf, sizeof(buf), "%s pixel (%d,%d) is %d,%d,%d,%d, expected %.2f,%.2f,%.2f,%.2f", what,
+                pixel % expected.width, pixel / expected.width, o[0], o[1], o[2], o[3], e[0], e[1], e[2], e[3]);
+            return buf;
+        }
+    }
+    return "";
+}
+
+inline std::string checkResampler() {
+    using gifcore::Resampler;
+    char buf[192];
+    std::mt19937 rng(4321);
+
+    //random colors under random alpha, gif style all or nothing alpha, nothing visible (the colors
+    //are garbage, output has to be transparent black), and fully opaque
+    enum Fill { RandomAlpha, BinaryAlpha, Transparent, Opaque };
+    static const char* fillNames[] = { "random alpha", "binary alpha", "transparent", "opaque" };
+    auto makeImage = [&](int width, int height, Fill fill) {
+        std::vector<GifByteType> image((size_t)width * height * 4);
+        for (size_t i = 0; i < image.size(); i += 4) {
+            for (int c = 0; c < 3; c++) image[i + c] = (GifByteType)(rng() % 256);
+            image[i + 3] = fill == RandomAlpha ? (GifByteType)(rng() % 256)
+                : fill == BinaryAlpha ? (rng() % 2 ? 255 : 0)
+                : fill == Transparent ? 0 : 255;
+        }
+        return image;
+    };
+
+    struct Case {
+        int width, height, dstWidth, dstHeight;
+    };
+    static const Case cases[] = {
+        { 64, 48, 16, 12 }, //4x, box only
+        { 30, 20, 10, 5 }, //3x by 4x
+        { 23, 17, 6, 6 }, //partial edge blocks, then bilinear
+        { 100, 70, 33, 29 }, //non integer, box then bilinear
+        { 17, 13, 7, 5 },
+        { 9, 9, 5, 5 }, //under 2x, bilinear only
+        { 37, 23, 1, 1 }, //1 pixel outputs
+        { 50, 3, 1, 1 },
+        { 5, 40, 1, 9 },
+        { 300, 300, 1, 1 }, //90000 pixel block, past what 32 bit sums hold
+        { 400, 200, 3, 2 },
+    };
+
+    for (auto& test : cases) {
+        for (int fill = RandomAlpha; fill <= Opaque; fill++) {
+            auto src = makeImage(test.width, test.height, (Fill)fill);
+            char what[96];
+
+            //box alone, every block the edges cut short included
+            int fx = Resampler::boxFactor(test.width, test.dstWidth), fy = Resampler::boxFactor(test.height, test.dstHeight);
+            //outputs start as junk so a pixel the kernel forgets to write shows up
+            std::vector<GifByteType> boxed((size_t)Resampler::boxSize(test.width, fx) * Resampler::boxSize(test.height, fy) * 4, 0xcd);
+            Resampler::boxRGBA(src.data(), test.width, test.height, fx, fy, boxed.data());
+            auto boxExpected = boxReference(src.data(), test.width, test.height, fx, fy);
+            snprintf(what, sizeof(what), "box %dx%d by %dx%d, %s,", test.width, test.height, fx, fy, fillNames[fill]);
+            std::string mismatch = compareResampled(what, boxed, boxExpected, false, 1.0);
+            if (!mismatch.empty()) return mismatch;
+
+            //bilinear alone, straight to the target size
+            std::vector<GifByteType> out((size_t)test.dstWidth * test.dstHeight * 4, 0xcd);
+            Resampler::bilinearRGBA(src.data(), test.width, test.height, out.data(), test.dstWidth, test.dstHeight);
+            snprintf(what, sizeof(what), "bilinear %dx%d to %dx%d, %s,", test.width, test.height, test.dstWidth, test.dstHeight, fillNames[fill]);
+            mismatch = compareResampled(what, out, bilinearReference(src.data(), test.width, test.height, test.dstWidth, test.dstHeight), true, 2.0);
+            if (!mismatch.empty()) return mismatch;
+
+            //downscale is box to bytes, then bilinear on those bytes when the box didnt land on the size
+            std::vector<GifByteType> scratch(Resampler::scratchBytes(test.width, test.height, test.dstWidth, test.dstHeight));
+            std::fill(out.begin(), out.end(), 0xcd);
+            Resampler::downscaleRGBA(src.data(), test.width, test.height, out.data(), test.dstWidth, test.dstHeight, scratch.data());
+            snprintf(what, sizeof(what), "downscale %dx%d to %dx%d, %s,", test.width, test.height, test.dstWidth, test.dstHeight, fillNames[fill]);
+            if (boxExpected.width == test.dstWidth and boxExpected.height == test.dstHeight) mismatch = compareResampled(what, out, boxExpected, false, 1.0);
+            else {
+                auto boxBytes = rounded(boxExpected);
+                auto expected = bilinearReference(boxBytes.data(), boxExpected.width, boxExpected.height, test.dstWidth, test.dstHeight);
+                mismatch = compareResampled(what, out, expected, true, 2.0);
+            }
+            if (!mismatch.empty()) return mismatch;
+            for (size_t i = 3; i < out.size() and fill == Opaque; i += 4) {
+                if (out[i] != 255) {
+                    snprintf(buf, sizeof(buf), "%s opaque input came out with alpha %d", what, out[i]);
+                    return buf;
+                }
+            }
+
+            //point sampling copies the pixel whose center is nearest, for rgba and index bytes alike
+            for (int bytesPerPixel : { 4, 1 }) {
+                std::vector<GifByteType> sampled((size_t)test.dstWidth * test.dstHeight * bytesPerPixel, 0xcd);
+                Resampler::pointSample(src.data(), test.width, test.height, bytesPerPixel, sampled.data(), test.dstWidth, test.dstHeight);
+                for (int dy = 0; dy < test.dstHeight; dy++) {
+                    int y = (int)std::floor((dy + 0.5) * test.height / test.dstHeight);
+                    for (int dx = 0; dx < test.dstWidth; dx++) {
+                        int x = (int)std::floor((dx + 0.5) * test.width / test.dstWidth);
+                        const GifByteType* expected = src.data() + ((size_t)y * test.width + x) * bytesPerPixel;
+                        if (memcmp(&sampled[((size_t)dy * test.dstWidth + dx) * bytesPerPixel], expected, bytesPerPixel) != 0) {
+                            snprintf(buf, sizeof(buf), "point sample %dx%d to %dx%d, %d bytes per pixel: (%d,%d) did not come from (%d,%d)",
+                                test.width, test.height, test.dstWidth, test.dstHeight, bytesPerPixel, dx, dy, x, y);
+                            return buf;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //alpha weighting: opaque color next to transparent pixels of any color keeps that color exactly,
+    //only alpha drops. half of an 8x8 block and a 300x300 one (64 bit sums) opaque
+    for (int size : { 8, 300 }) {
+        std::vector<GifByteType> src((size_t)size * size * 4);
+        for (int i = 0; i < size * size; i++) {
+            GifByteType* p = &src[(size_t)i * 4];
+            bool opaque = (i % size + i / size) % 2 == 0;
+            GifByteType color[4] = { 200, 40, 90, 255 };
+            GifByteType garbage[4] = { 255, 255, 255, 0 };
+            memcpy(p, opaque ? color : garbage, 4);
+        }
+        GifByteType out[4];
+        Resampler::downscaleRGBA(src.data(), size, size, out, 1, 1, nullptr);
+        if (out[0] != 200 or out[1] != 40 or out[2] != 90 or out[3] != 128) {
+            snprintf(buf, sizeof(buf), "%dx%d half transparent block averaged to %d,%d,%d,%d, expected 200,40,90,128", size, size, out[0], out[1], out[2], out[3]);
+            return buf;
+        }
+    }
+
+    //white everywhere is the largest sum a block can have
+    std::vector<GifByteType> white((size_t)300 * 300 * 4, 255);
+    GifByteType out[4];
+    Resampler::boxRGBA(white.data(), 300, 300, 300, 300, out);
+    if (out[0] != 255 or out[1] != 255 or out[2] != 255 or out[3] != 255) {
+        snprintf(buf, sizeof(buf), "300x300 white block averaged to %d,%d,%d,%d", out[0], out[1], out[2], out[3]);
+        return buf;
+    }
+    return "";
+}
+
+}
@@ -0,0 +1,24 @@
+//full pipeline: gifcore::Decoder (rgba and indexed) checked against the reference compositor,
+//any disagreement aborts so the fuzzer keeps the input
+#include <reference_compositor.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    //small limit keeps every run fast and far away from the rss limit
+    const size_t maxCanvasPixels = 1024 * 1024;
+
+    for (bool indexed : { false, true }) {
+        std::string mismatch = reference::compare(data, size, indexed, maxCanvasPixels);
+        if (!mismatch.empty()) {
+            fprintf(stderr, "decoder/reference mismatch (%s): %s\n", indexed ? "indexed" : "rgba", mismatch.c_str());
+            abort();
+        }
+    }
+
+    //probe walks the same untrusted blocks without decoding, it only has to survive them
+    gifcore::GIFInfo info;
+    gifcore::Decoder().probe(data, size, "fuzz", info);
+    return 0;
+}
@@ -0,0 +1,38 @@
+//giflib only: DGifOpen + DGifSlurp on arbitrary bytes, plus the gcb parsing the decoder relies on
+#include <gif_lib.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+struct Reader {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+};
+
+static int readInput(GifFileType* gif, GifByteType* buf, int count) {
+    auto reader = static_cast<Reader*>(gif->UserData);
+    size_t n = count < 0 ? 0 : std::min<size_t>((size_t)count, reader->size - reader->position);
+    memcpy(buf, reader->data + reader->position, n);
+    reader->position += n;
+    return (int)n;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    Reader reader = { data, size, 0 };
+    int error = 0;
+    GifFileType* gif = DGifOpen(&reader, readInput, &error);
+    if (!gif) return 0;
+
+    if (DGifSlurp(gif) == GIF_OK) {
+        for (int i = 0; i < gif->ImageCount; i++) {
+            GraphicsControlBlock gcb;
+            DGifSavedExtensionToGCB(gif, i, &gcb);
+        }
+    }
+
+    DGifCloseFile(gif);
+    return 0;
+}
@@ -0,0 +1,31 @@
+//driver for compilers without libFuzzer (gcc, afl-clang-fast++ with @@),
+//runs every file given on the command line once, or stdin when there are none
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static void runOne(std::istream& in) {
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        runOne(std::cin);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "Failed to open %s\n", argv[i]);
+            return 1;
+        }
+        runOne(file);
+    }
+    return 0;
+}
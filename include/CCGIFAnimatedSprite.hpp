@@ -2,6 +2,176 @@
 
 #include <Geode/utils/cocos.hpp>
 
+#ifdef GEODE_IS_WINDOWS
+    #ifdef GIF_SPRITES_EXPORTING
+        #define GIF_SPRITES_DLL __declspec(dllexport)
+    #else
+        #define GIF_SPRITES_DLL __declspec(dllimport)
+    #endif
+#else
+    #define GIF_SPRITES_DLL __attribute__((visibility("default")))
+#endif
+
+NS_CC_BEGIN;
+
+//shared between mod and api users, called on main thread after each gif of the batch
+using CCGIFPreloadCallback = std::function<void(size_t loaded, size_t total)>;
+
+class CCGIFAnimatedSprite;
+//main thread, once a createAsync() sprite shows its first frame (or failed to load)
+using CCGIFLoadCallback = std::function<void(CCGIFAnimatedSprite* sprite, bool success)>;
+
+//texture format for gif frames
+enum class CCGIFPixelFormat {
+    Auto, //16 bit only when every palette color survives it, else RGB888 for opaque gifs and RGBA8888 otherwise
+    AutoLossy, //RGB565 for opaque gifs, RGB5A1 otherwise
+    RGBA8888,
+    RGBA4444,
+    RGB5A1,
+    RGB565, //falls back to RGB5A1 if gif has transparency
+    Indexed, //A8 palette indices + 256x1 palette texture, falls back to Auto above 255 colors
+    RGB888, //falls back to RGBA8888 if gif has transparency
+};
+
+struct CCGIFLoadOptions {
+    CCGIFPixelFormat pixelFormat = CCGIFPixelFormat::Auto;
+    //share one playhead with every other synchronized sprite of the same gif (same file and pixel format)
+    bool synchronized = false;
+    //frames bigger than needed are downscaled before upload, the sprite keeps the full gif size.
+    //longest texture side in pixels and largest scale the sprite is drawn at, 0 = no limit
+    unsigned int maxTextureSize = 0;
+    float maxScale = 0.f;
+    //trilinear filtering for gifs drawn small, only when the (downscaled) size is a power of two
+    bool mipmaps = false;
+};
+
+//where a gif load spends its time, indexes CCGIFLoadHistogram::stages
+enum class CCGIFLoadStage {
+    Read, //file read from disk/apk
+    Sniff, //GIF87a/GIF89a header check in CCSprite::create hook
+    Hash, //checksum for the cache key
+    Decode, //lzw decode
+    Composite, //disposal + palette lookup into canvas
+    Upload, //texture creation
+    Total,
+    Count
+};
+
+//one load, milliseconds. decode/composite/upload stay 0 when it came from cache
+struct CCGIFLoadStats {
+    float readMs = 0.f;
+    float sniffMs = 0.f;
+    float hashMs = 0.f;
+    float decodeMs = 0.f;
+    float compositeMs = 0.f;
+    float uploadMs = 0.f;
+    float totalMs = 0.f;
+    size_t fileBytes = 0;
+    size_t textureBytes = 0;
+    unsigned int frameCount = 0;
+    bool fromCache = false; //found in the cache or took another loads decode, set by whoever looked it up
+    unsigned int duplicateFrames = 0; //identical consecutive frames merged into the one before, not in frameCount
+};
+
+//log2 buckets, bucket i counts samples in [2^i, 2^(i+1)) microseconds (bucket 0 also takes < 1us)
+struct CCGIFStageHistogram {
+    static constexpr int BucketCount = 24;
+    unsigned int buckets[BucketCount] = {};
+    unsigned int count = 0;
+    double totalMs = 0.0;
+    float maxMs = 0.f;
+};
+
+//every load since start (or last reset), including background preloads
+struct CCGIFLoadHistogram {
+    CCGIFStageHistogram stages[static_cast<int>(CCGIFLoadStage::Count)];
+    unsigned int loads = 0;
+    unsigned int cacheHits = 0;
+    size_t fileBytes = 0;
+    size_t textureBytes = 0;
+    size_t frames = 0;
+    size_t duplicateFrames = 0;
+
+    CCGIFStageHistogram const& operator[](CCGIFLoadStage stage) const { return stages[static_cast<int>(stage)]; }
+};
+
+//texture uploads of preloaded gifs, spread over ticks under the upload budget
+struct CCGIFUploadStats {
+    size_t uploaded = 0; //frames
+    size_t failed = 0;
+    size_t dropped = 0; //gif left the cache before its frames came up
+    size_t bytes = 0;
+    size_t pending = 0;
+    size_t ticks = 0; //ticks that uploaded something
+    size_t deferredTicks = 0; //ticks that ran out of budget with frames left
+    float totalMs = 0.f;
+    float maxTickMs = 0.f;
+};
+
+//bytes held by one gif (one cache key), shared textures are counted once
+struct CCGIFMemoryEntry {
+    std::string filename;
+    std::string checksum; //cache key checksum, differs per load options
+    size_t textureBytes = 0;
+    size_t cpuBytes = 0; //approximate: sprite/frame objects and frame arrays
+    unsigned int liveSprites = 0;
+    unsigned int frameCount = 0;
+    bool cached = false;
+};
+
+struct CCGIFMemoryReport {
+    std::vector<CCGIFMemoryEntry> entries; //biggest texture users first
+    size_t textureBytes = 0;
+    size_t cpuBytes = 0; //entries + staging pool
+    size_t stagingBytes = 0; //idle upload buffers kept for reuse
+    unsigned int liveSprites = 0;
+    unsigned int cacheEntries = 0;
+};
+
+//read from the gif block structure alone, nothing is decoded or uploaded for it
+struct CCGIFInfo {
+    bool valid = false; //readable gif with at least one image
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int frameCount = 0; //images in the file, a load merges identical consecutive ones so the sprite can have fewer
+    float duration = 0.f; //seconds for one pass
+    int loopCount = -1; //NETSCAPE2.0 block: 0 = forever, -1 = no block. sprites loop either way, see setLoop
+};
+
+//CCGIFAnimatedSprite's members in declaration order, gif and mod internal types swapped for same sized ones.
+//the mirror below and the real class in the mod both static_assert their size against it,
+//a member added on one side only fails to compile instead of shifting fields under api users
+struct CCGIFAnimatedSpriteLayout : public CCSprite {
+    CCArray* m_frames;
+    unsigned int m_currentFrame;
+    float m_frameTimer;
+    bool m_isPlaying;
+    bool m_loop;
+    int m_canvasWidth;
+    int m_canvasHeight;
+    unsigned char* m_canvasBuffer;
+    unsigned char* m_previousBuffer;
+    void* m_globalColorMap;
+    bool m_hasTransparentBackground;
+    std::string m_filename;
+    std::string m_checksum;
+    CCGIFLoadOptions m_loadOptions;
+    CCTexture2D* m_paletteTexture;
+    CCGIFLoadStats m_loadStats;
+    CCTexture2D* m_staticTexture;
+    bool m_isOpaque;
+    double m_frameStartTime;
+    unsigned int m_anchorFrame;
+    unsigned int m_lastVisitTick;
+    bool m_dormant;
+    void* m_syncGroup;
+    std::shared_ptr<void> m_loadJob;
+    std::shared_ptr<void> m_cacheEntry;
+    bool m_textureLost;
+};
+
+NS_CC_END;
+
 #if !defined(_GIF_LIB_H_)
 
 #define gifbool unsigned char
@@ -26,10 +196,17 @@ typedef struct GifImageDesc {
 } GifImageDesc;
 
 
+namespace gifcore {
+    struct JobControl;
+}
+
 NS_CC_BEGIN;
 
+struct CCGIFSyncGroup;
+struct CCGIFCacheData;
+
 //its only member reference and cast helper...
-class CCGIFAnimatedSprite : public CCSprite { //728bytes
+class CCGIFAnimatedSprite : public CCSprite {
 public:
     class GIFFrame : public CCObject {
     public:
@@ -46,6 +223,17 @@ public:
         return cast;
     }
 
+    GIF_SPRITES_DLL static CCGIFAnimatedSprite* createWithOptions(const char* file, CCGIFLoadOptions const& options);
+    //returns an empty sprite right away and decodes in background, it shows the gif once its ready.
+    //on screen sprites decode first, preloads last. releasing the sprite before that cancels the decode
+    GIF_SPRITES_DLL static CCGIFAnimatedSprite* createAsync(const char* file, CCGIFLoadOptions const& options, CCGIFLoadCallback callback = nullptr);
+    bool isLoading() const { return m_loadJob != nullptr; }
+    //size, frame count, duration and loop count without creating a sprite, main thread
+    GIF_SPRITES_DLL static CCGIFInfo probe(const char* file);
+    //options used by CCSprite::create() and preload()
+    GIF_SPRITES_DLL static void setDefaultLoadOptions(CCGIFLoadOptions const& options);
+    GIF_SPRITES_DLL static CCGIFLoadOptions getDefaultLoadOptions();
+
     void play() { m_isPlaying = true; }
     void pause() { m_isPlaying = false; }
     void stop() { m_isPlaying = false; m_currentFrame = 0; }
@@ -65,7 +253,35 @@ public:
         }
     }
 
-    unsigned int getFrameCount() const { return m_frames ? m_frames->count() : 0; }
+    unsigned int getFrameCount() const { return m_frames ? m_frames->count() : (m_staticTexture ? 1 : 0); }
+
+    //follow the shared playhead of every synchronized sprite of this gif (or go back to an own one).
+    //pause() still freezes just this sprite, it picks the shared frame up again on the next change after play()
+    GIF_SPRITES_DLL void setSynchronized(bool synchronized);
+    bool isSynchronized() const { return m_syncGroup != nullptr; }
+
+    //decode a batch of gifs in background and put them into cache,
+    //higher priority batches go first
+    GIF_SPRITES_DLL static void preload(std::vector<std::string> const& paths, int priority = 0, CCGIFPreloadCallback callback = nullptr);
+    //preloaded frames reach the gpu over several ticks, at most this much per tick
+    //(at least one frame always goes). bytes = 0 means time only, default 4ms
+    GIF_SPRITES_DLL static void setUploadBudget(float milliseconds, size_t bytes = 0);
+    GIF_SPRITES_DLL static CCGIFUploadStats getUploadStats();
+
+    //timings of the load that made this sprite
+    CCGIFLoadStats const& getLoadStats() const { return m_loadStats; }
+    //aggregated over all loads, thread safe copy
+    GIF_SPRITES_DLL static CCGIFLoadHistogram getLoadHistogram();
+    GIF_SPRITES_DLL static void resetLoadHistogram();
+
+    //what every gif holds right now, main thread only
+    GIF_SPRITES_DLL static CCGIFMemoryReport getMemoryReport();
+    GIF_SPRITES_DLL static void logMemoryReport();
+    //drops the frame textures of gifs nobody has on screen, returns the texture bytes that got freed.
+    //preloads no sprite has used yet are left alone.
+    //runs on its own from CCTextureCache::removeUnusedTextures and CCDirector::purgeCachedData,
+    //the file stays in memory and frames come back in background once a sprite shows the gif again
+    GIF_SPRITES_DLL static size_t releaseUnusedFrames();
 
     CCArray* m_frames = nullptr;
     unsigned int m_currentFrame = 0;
@@ -80,7 +296,21 @@ public:
     bool m_hasTransparentBackground = false;
     std::string m_filename = "";
     std::string m_checksum = "";
+    CCGIFLoadOptions m_loadOptions;
+    CCTexture2D* m_paletteTexture = nullptr;
+    CCGIFLoadStats m_loadStats;
+    CCTexture2D* m_staticTexture = nullptr; //single frame gifs, m_frames stays null
+    bool m_isOpaque = false; //drawn without blending
+    double m_frameStartTime = 0.0; //playback clock time the current frame started at
+    unsigned int m_anchorFrame = 0;
+    unsigned int m_lastVisitTick = 0;
+    bool m_dormant = false; //not drawn last tick, out of the update loop until it is again
+    CCGIFSyncGroup* m_syncGroup = nullptr; //set while synchronized
+    std::shared_ptr<gifcore::JobControl> m_loadJob; //set while createAsync() is decoding
+    std::shared_ptr<CCGIFCacheData> m_cacheEntry; //what its frames came from, kept to rebuild them
+    bool m_textureLost = false; //gl context loss took its texture, not drawn until the rebuilt one is in
 };
+static_assert(sizeof(CCGIFAnimatedSprite) == sizeof(CCGIFAnimatedSpriteLayout), "CCGIFAnimatedSprite members out of sync with CCGIFAnimatedSpriteLayout");
 
 NS_CC_END;
 
@@ -2,8 +2,23 @@
 using namespace geode::prelude;
 
 #include <gif_lib.h>
+#include <gifcore/Decoder.hpp>
+#include <gifcore/Resampler.hpp>
+#include <gifcore/ShardedCache.hpp>
+#include <gifcore/TaskScheduler.hpp>
+#include <gifcore/UploadQueue.hpp>
 #include <CCGIFAnimatedSprite.hpp>//asd
 
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
 NS_CC_BEGIN;
 
 //forward decl
@@ -11,15 +26,29 @@ class CCGIFAnimatedSprite;
 
 struct CCGIFCacheData : public CCObject {
     CCArray* frames;
+    CCTexture2D* paletteTexture; //only for indexed gifs
+    CCTexture2D* staticTexture; //single frame gifs have this instead of frames
     GifWord canvasWidth;
     GifWord canvasHeight;
     bool hasTransparentBackground;
+    bool isOpaque;
     std::string checksum;
-
-    CCGIFCacheData() : frames(nullptr), canvasWidth(0), canvasHeight(0), hasTransparentBackground(false) {}
+    std::string filename;
+    //what the textures get rebuilt from after releaseUnusedFrames() dropped them.
+    //the gif file itself, a few percent of the textures it decodes into
+    CCGIFLoadOptions options;
+    std::shared_ptr<const std::vector<unsigned char>> source;
+    bool evicted; //frame/static textures are gone, the frame objects stay
+    bool restoring; //background decode for it is running
+    bool contextLost; //gl context went away, the palette texture object is refilled in place on restore
+    bool used; //a sprite took it at least once, preloads nobody used yet are never evicted
+
+    CCGIFCacheData() : frames(nullptr), paletteTexture(nullptr), staticTexture(nullptr), canvasWidth(0), canvasHeight(0), hasTransparentBackground(false), isOpaque(false), evicted(false), restoring(false), contextLost(false), used(false) {}
 
     virtual ~CCGIFCacheData() {
         CC_SAFE_RELEASE(frames);
+        CC_SAFE_RELEASE(paletteTexture);
+        CC_SAFE_RELEASE(staticTexture);
     }
 
     static CCGIFCacheData* create() {
@@ -35,25 +64,49 @@ struct CCGIFCacheData : public CCObject {
 
 class CCGIFCacheManager {
 public:
-    inline static CCGIFCacheManager* s_sharedInstance = nullptr;
-    std::map<std::string, CCGIFCacheData*> m_cache;
+    //cache entries are shared so workers can hold them, the CCObject inside only ever sees the main thread
+    using Entry = std::shared_ptr<CCGIFCacheData>;
+
+    //a decode somebody already started, later requests for the same key wait on it instead of decoding again.
+    //stays registered until the result is in the cache (or given up), not just until the decode ends,
+    //else a request landing between the worker finishing and the main thread caching would decode again
+    struct InFlight {
+        std::string key;
+        bool decoded = false; //guarded by m_flightMutex
+        //set by preload workers, main thread loads cache their textures directly and leave it null
+        std::shared_ptr<gifcore::DecodedGIF> result;
+        CCGIFLoadStats stats;
+    };
+
+    inline static std::atomic<CCGIFCacheManager*> s_sharedInstance = nullptr;
+    //mods are loaded on the main thread, so is this
+    inline static const std::thread::id s_mainThread = std::this_thread::get_id();
+    gifcore::ShardedCache<CCGIFCacheData> m_cache;
+    std::unordered_map<std::string, std::shared_ptr<InFlight>> m_inFlight;
+    std::mutex m_flightMutex;
+    std::condition_variable m_flightDecoded;
 
     CCGIFCacheManager() {}
 
+    //first call may come from a preload worker
     static CCGIFCacheManager* get() {
-        s_sharedInstance = s_sharedInstance ? s_sharedInstance : new CCGIFCacheManager();
-        return s_sharedInstance;
+        if (auto instance = s_sharedInstance.load(std::memory_order_acquire)) return instance;
+        static std::mutex creation;
+        std::lock_guard lock(creation);
+        if (!s_sharedInstance.load(std::memory_order_relaxed)) s_sharedInstance.store(new CCGIFCacheManager(), std::memory_order_release);
+        return s_sharedInstance.load(std::memory_order_relaxed);
     }
 
     static void destroyInstance() {
-        if (!s_sharedInstance) return;
-        s_sharedInstance->purgeCache();
-        CC_SAFE_DELETE(s_sharedInstance);
-        s_sharedInstance = nullptr;
+        auto instance = s_sharedInstance.exchange(nullptr);
+        if (!instance) return;
+        instance->purgeCache();
+        CC_SAFE_DELETE(instance);
     }
 
     //md5 checksum of file data
-    std::string calculateChecksum(const unsigned char* data, unsigned long size) {
+    //static so preload workers can hash without touching the singleton
+    static std::string calculateChecksum(const unsigned char* data, unsigned long size) {
         unsigned int hash = 0x811c9dc5; // FNV-1a hash
         for (unsigned long i = 0; i < size; i++) {
             hash ^= data[i];
@@ -64,52 +117,45 @@ public:
         return std::string(checksumStr);
     }
 
-    CCGIFCacheData* getCachedGIF(const std::string& filename, const std::string& checksum) {
-        std::string key = filename + "_" + checksum;
-        auto a = m_cache.find(key);
-        if (a != m_cache.end()) {
-            log::debug("GIF cache hit for: {}", filename);
-            return a->second;
-        }
-        return nullptr;
+    static std::string makeKey(const std::string& filename, const std::string& checksum) {
+        return filename + "_" + checksum;
     }
 
-    void cacheGIF(const std::string& filename, const std::string& checksum, CCGIFCacheData* data) {
-        if (!data) return;
+    //holds a reference for as long as any copy lives, the last one lets go of it on the main thread
+    static Entry makeEntry(CCGIFCacheData* data) {
+        data->retain();
+        return Entry(data, [](CCGIFCacheData* data) {
+            if (std::this_thread::get_id() == s_mainThread) data->release();
+            else Loader::get()->queueInMainThread([data] { data->release(); });
+        });
+    }
 
-        std::string key = filename + "_" + checksum;
+    Entry getCachedGIF(const std::string& filename, const std::string& checksum) {
+        auto entry = m_cache.find(makeKey(filename, checksum));
+        if (entry) log::debug("GIF cache hit for: {}", filename);
+        return entry;
+    }
 
-        //remove old entry if exists
-        auto it = m_cache.find(key);
-        if (it != m_cache.end()) {
-            it->second->release();
-            m_cache.erase(it);
-        }
+    //main thread, data is retained by the cache
+    Entry cacheGIF(const std::string& filename, const std::string& checksum, CCGIFCacheData* data) {
+        if (!data) return nullptr;
 
-        //add new entry
-        data->retain();
-        m_cache[key] = data;
+        data->filename = filename;
+        auto entry = makeEntry(data);
+        //returns the old entry for the key (if any), released right here outside the shard lock
+        m_cache.insert(makeKey(filename, checksum), entry);
 
         log::debug("Cached GIF: {} (checksum: {})", filename, checksum);
+        return entry;
     }
 
     // remove all entries for this filename (different checksums)
     void removeGIF(const std::string& filename) {
-        for (auto it = m_cache.begin(); it != m_cache.end();) {
-            if (it->first.find(filename + "_") == 0) {
-                it->second->release();
-                it = m_cache.erase(it);
-            }
-            else {
-                ++it;
-            }
-        }
+        std::string prefix = filename + "_";
+        m_cache.eraseIf([&](const std::string& key, const CCGIFCacheData&) { return key.find(prefix) == 0; });
     }
 
     void purgeCache() {
-        for (auto& pair : m_cache) {
-            pair.second->release();
-        }
         m_cache.clear();
         log::debug("GIF cache purged");
     }
@@ -118,16 +164,291 @@ public:
         return m_cache.size();
     }
 
+    bool isCached(const std::string& key) const {
+        return m_cache.contains(key);
+    }
+
+    //true if the caller is the first to load this key and must endLoad() it later,
+    //false if someone else is on it already: flight is theirs, waitFor() it
+    bool beginLoad(const std::string& key, std::shared_ptr<InFlight>& flight) {
+        std::lock_guard lock(m_flightMutex);
+        auto& slot = m_inFlight[key];
+        if (slot) {
+            flight = slot;
+            return false;
+        }
+        slot = flight = std::make_shared<InFlight>();
+        flight->key = key;
+        return true;
+    }
+
+    //decode is over, waiters can take the result while the owner gets it into the cache
+    void finishDecode(std::shared_ptr<InFlight> const& flight, std::shared_ptr<gifcore::DecodedGIF> result, CCGIFLoadStats const& stats) {
+        {
+            std::lock_guard lock(m_flightMutex);
+            flight->result = std::move(result);
+            flight->stats = stats;
+            flight->decoded = true;
+        }
+        m_flightDecoded.notify_all();
+    }
+
+    //cached or failed, the next request for this key goes through the cache again
+    void endLoad(std::shared_ptr<InFlight> const& flight) {
+        {
+            std::lock_guard lock(m_flightMutex);
+            flight->decoded = true;
+            auto it = m_inFlight.find(flight->key);
+            if (it != m_inFlight.end() and it->second == flight) m_inFlight.erase(it);
+        }
+        m_flightDecoded.notify_all();
+    }
+
+    //null if the owner failed or loaded it on the main thread (then its already cached)
+    std::shared_ptr<gifcore::DecodedGIF> waitFor(std::shared_ptr<InFlight> const& flight) {
+        std::unique_lock lock(m_flightMutex);
+        m_flightDecoded.wait(lock, [&] { return flight->decoded; });
+        return flight->result;
+    }
+
     void logCacheStats() {
         log::debug("GIF Cache Stats: {} entries", m_cache.size());
-        for (const auto& pair : m_cache) {
-            log::debug("  - {}", pair.first);
+        m_cache.forEach([](const std::string& key, const CCGIFCacheData&) {
+            log::debug("  - {}", key);
+        });
+    }
+};
+
+//reusable staging memory for texture uploads that need conversion,
+//bounded so a huge gif doesnt pin its buffers forever
+class CCGIFStagingPool {
+public:
+    struct Stats {
+        size_t acquires = 0;
+        size_t reuses = 0;
+        size_t allocations = 0;
+        size_t discards = 0; //returned buffers freed because pool was full
+        size_t bytesHeld = 0;
+        size_t peakBytesHeld = 0;
+    };
+
+    //returns itself to the pool when it goes out of scope
+    class Buffer {
+    public:
+        void* data = nullptr;
+        size_t capacity = 0;
+
+        Buffer() = default;
+        Buffer(void* data, size_t capacity) : data(data), capacity(capacity) {}
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        ~Buffer() { if (data) CCGIFStagingPool::get()->release(data, capacity); }
+    };
+
+    inline static CCGIFStagingPool* s_sharedInstance = nullptr;
+    size_t m_maxBuffers = 4;
+    size_t m_maxBytes = 32 * 1024 * 1024;
+    std::vector<std::pair<void*, size_t>> m_free;
+    Stats m_stats;
+    std::mutex m_mutex;
+
+    static CCGIFStagingPool* get() {
+        s_sharedInstance = s_sharedInstance ? s_sharedInstance : new CCGIFStagingPool();
+        return s_sharedInstance;
+    }
+
+    //smallest pooled buffer that fits, or a fresh one
+    void* acquire(size_t size, size_t& capacity) {
+        std::lock_guard lock(m_mutex);
+        m_stats.acquires++;
+
+        auto best = m_free.end();
+        for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+            if (it->second >= size and (best == m_free.end() or it->second < best->second)) best = it;
+        }
+        if (best != m_free.end()) {
+            void* data = best->first;
+            capacity = best->second;
+            m_stats.bytesHeld -= capacity;
+            m_free.erase(best);
+            m_stats.reuses++;
+            return data;
+        }
+
+        m_stats.allocations++;
+        capacity = size;
+        return malloc(size);
+    }
+
+    void release(void* data, size_t capacity) {
+        if (!data) return;
+        std::lock_guard lock(m_mutex);
+        if (m_free.size() >= m_maxBuffers or m_stats.bytesHeld + capacity > m_maxBytes) {
+            m_stats.discards++;
+            free(data);
+            return;
+        }
+        m_free.emplace_back(data, capacity);
+        m_stats.bytesHeld += capacity;
+        m_stats.peakBytesHeld = std::max(m_stats.peakBytesHeld, m_stats.bytesHeld);
+    }
+
+    void purge() {
+        std::lock_guard lock(m_mutex);
+        for (auto& pair : m_free) free(pair.first);
+        m_free.clear();
+        m_stats.bytesHeld = 0;
+    }
+
+    Stats getStats() {
+        std::lock_guard lock(m_mutex);
+        return m_stats;
+    }
+};
+
+//global load histogram. loads are recorded on the main thread (sync creates, upload queue callbacks),
+//the lock is for getLoadHistogram()/resetLoadHistogram() callers on other threads
+class CCGIFLoadTelemetry {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    inline static CCGIFLoadTelemetry* s_sharedInstance = nullptr;
+    CCGIFLoadHistogram m_histogram;
+    std::mutex m_mutex;
+
+    static CCGIFLoadTelemetry* get() {
+        s_sharedInstance = s_sharedInstance ? s_sharedInstance : new CCGIFLoadTelemetry();
+        return s_sharedInstance;
+    }
+
+    static float msSince(Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    void addSample(CCGIFLoadStage stage, float ms) {
+        std::lock_guard lock(m_mutex);
+        addSampleLocked(stage, ms);
+    }
+
+    //decode side stages are skipped for cache hits so they dont drag the histogram to 0
+    void record(CCGIFLoadStats const& stats) {
+        std::lock_guard lock(m_mutex);
+        addSampleLocked(CCGIFLoadStage::Read, stats.readMs);
+        addSampleLocked(CCGIFLoadStage::Hash, stats.hashMs);
+        if (!stats.fromCache) {
+            addSampleLocked(CCGIFLoadStage::Decode, stats.decodeMs);
+            addSampleLocked(CCGIFLoadStage::Composite, stats.compositeMs);
+            addSampleLocked(CCGIFLoadStage::Upload, stats.uploadMs);
         }
+        addSampleLocked(CCGIFLoadStage::Total, stats.totalMs);
+
+        m_histogram.loads++;
+        if (stats.fromCache) m_histogram.cacheHits++;
+        m_histogram.fileBytes += stats.fileBytes;
+        m_histogram.textureBytes += stats.textureBytes;
+        m_histogram.frames += stats.frameCount;
+        m_histogram.duplicateFrames += stats.duplicateFrames;
+    }
+
+    CCGIFLoadHistogram getHistogram() {
+        std::lock_guard lock(m_mutex);
+        return m_histogram;
+    }
+
+    void reset() {
+        std::lock_guard lock(m_mutex);
+        m_histogram = CCGIFLoadHistogram();
+    }
+
+private:
+    void addSampleLocked(CCGIFLoadStage stage, float ms) {
+        auto& h = m_histogram.stages[static_cast<int>(stage)];
+        int bucket = 0;
+        for (float us = ms * 1000.f; us >= 2.f and bucket < CCGIFStageHistogram::BucketCount - 1; us *= 0.5f) bucket++;
+        h.buckets[bucket]++;
+        h.count++;
+        h.totalMs += ms;
+        h.maxMs = std::max(h.maxMs, ms);
+    }
+};
+
+//synchronized sprites of one cache key, they all show the frame of this one playhead
+struct CCGIFSyncGroup {
+    std::string key;
+    std::vector<float> delays;
+    double duration = 0.0;
+    unsigned int currentFrame = 0;
+    double frameStartTime = 0.0;
+    std::unordered_set<CCGIFAnimatedSprite*> members;
+    //members drawn recently, the only ones a frame change touches. the rest pick it up in visit()
+    std::unordered_set<CCGIFAnimatedSprite*> active;
+};
+
+//advanced by the playback clock, one playhead walk per gif per tick and
+//sprite work only when the shared frame actually changes (main thread only)
+class CCGIFSyncGroups {
+public:
+    inline static CCGIFSyncGroups* s_sharedInstance = nullptr;
+    std::unordered_map<std::string, CCGIFSyncGroup*> m_groups;
+
+    static CCGIFSyncGroups* get() {
+        if (!s_sharedInstance) s_sharedInstance = new CCGIFSyncGroups();
+        return s_sharedInstance;
+    }
+
+    //defined after CCGIFAnimatedSprite, they touch its members
+    CCGIFSyncGroup* join(CCGIFAnimatedSprite* sprite);
+    void leave(CCGIFAnimatedSprite* sprite);
+    void tick(double now, unsigned int tick);
+};
+
+//one time base for every gif sprite, ticked by the scheduler so it stops with director pause and follows time scale.
+//sprites that dropped out of the tick set read it when they come back to land on the right frame
+class CCGIFPlaybackClock : public CCObject {
+public:
+    inline static CCGIFPlaybackClock* s_sharedInstance = nullptr;
+    double m_time = 0.0;
+    unsigned int m_tick = 0;
+
+    static CCGIFPlaybackClock* get() {
+        if (!s_sharedInstance) {
+            s_sharedInstance = new CCGIFPlaybackClock();
+            //right after system targets, so it ticks before any sprite update of the same frame
+            CCDirector::get()->getScheduler()->scheduleUpdateForTarget(s_sharedInstance, INT_MIN + 1, false);
+        }
+        return s_sharedInstance;
+    }
+
+    virtual void update(float dt) override {
+        m_time += dt;
+        m_tick++;
+        if (CCGIFSyncGroups::s_sharedInstance) CCGIFSyncGroups::s_sharedInstance->tick(m_time, m_tick);
+    }
+};
+
+//gifcore has no geode dependency, route its messages into mod log here
+static void forwardDecoderLog(gifcore::Decoder& decoder) {
+    decoder.m_log = [](gifcore::LogLevel level, const std::string& message) {
+        switch (level) {
+        case gifcore::LogLevel::Error: log::error("{}", message); break;
+        case gifcore::LogLevel::Warn: log::warn("{}", message); break;
+        default: log::debug("{}", message); break;
+        }
+    };
+}
+
+//after a gl context loss every texture name is dead and new textures can be handed the same numbers,
+//a forgotten name keeps the destructor from deleting somebody elses texture. m_uName is protected
+struct CCGIFTextureAccess : public CCTexture2D {
+    static void forgetName(CCTexture2D* texture) {
+        if (texture) static_cast<CCGIFTextureAccess*>(texture)->m_uName = 0;
     }
 };
 
 class CCGIFAnimatedSprite : public CCSprite {
 public: //anyways its internal impl, why to private members
+    //shared by the cache entry and every sprite of that gif. m_texture stays null
+    //while a preloaded frame waits in CCGIFUploadQueue, playback holds the frame before it meanwhile
     class GIFFrame : public CCObject {
     public:
         CCTexture2D* m_texture = nullptr;
@@ -137,20 +458,6 @@ public: //anyways its internal impl, why to private members
         int m_transparentColorIndex = -1;
 
         virtual ~GIFFrame() { CC_SAFE_RELEASE(m_texture); }
-
-        //create a copy of this frame for caching
-        GIFFrame* copy() {
-            GIFFrame* newFrame = new GIFFrame();
-            newFrame->m_delay = m_delay;
-            newFrame->imageDesc = imageDesc;
-            newFrame->m_disposalMethod = m_disposalMethod;
-            newFrame->m_transparentColorIndex = m_transparentColorIndex;
-            if (m_texture) {
-                newFrame->m_texture = m_texture;
-                newFrame->m_texture->retain();
-            }
-            return newFrame;
-        }
     };
 
     CCArray* m_frames = nullptr;
@@ -160,124 +467,146 @@ public: //anyways its internal impl, why to private members
     bool m_loop = true;
     GifWord m_canvasWidth = 0;
     GifWord m_canvasHeight = 0;
+    //compositing lives in gifcore::Decoder now, these stay null
+    //but keep the layout include/CCGIFAnimatedSprite.hpp mirrors
     GifByteType* m_canvasBuffer = nullptr;
     GifByteType* m_previousBuffer = nullptr;
     ColorMapObject* m_globalColorMap = nullptr;
     bool m_hasTransparentBackground = false;
     std::string m_filename = "";
     std::string m_checksum = "";
+    CCGIFLoadOptions m_loadOptions;
+    //256x1 color lookup for indexed frames, frame textures are A8 indices then
+    CCTexture2D* m_paletteTexture = nullptr;
+    CCGIFLoadStats m_loadStats;
+    //single frame gifs: no frames array and no update schedule, just this texture
+    CCTexture2D* m_staticTexture = nullptr;
+    //every composited pixel is opaque, drawn without blending
+    bool m_isOpaque = false;
+    //CCGIFPlaybackClock time the current frame started at, m_frameTimer follows from it
+    double m_frameStartTime = 0.0;
+    //frame m_frameStartTime belongs to, differs after the inline setters in the public header ran
+    unsigned int m_anchorFrame = 0;
+    //clock tick of the last visit() that found the sprite on screen
+    unsigned int m_lastVisitTick = 0;
+    //left the tick set because it wasnt drawn, visit() brings it back
+    bool m_dormant = false;
+    //shared playhead while synchronized, the sprite has no update schedule then
+    CCGIFSyncGroup* m_syncGroup = nullptr;
+    //createAsync() decode still running, the sprite keeps its priority up to date and cancels it when destroyed
+    std::shared_ptr<gifcore::JobControl> m_loadJob;
+    //cache entry its frames are shared with, outlives removal from the cache so dropped textures can come back
+    CCGIFCacheManager::Entry m_cacheEntry;
+    //what its showing died with the gl context, not drawn until visit() swaps in the rebuilt texture
+    bool m_textureLost = false;
+
+    //used by CCSprite::create hook and preload
+    inline static CCGIFLoadOptions s_defaultLoadOptions;
+    //every sprite alive, for memory reports (main thread only)
+    inline static std::unordered_set<CCGIFAnimatedSprite*> s_liveSprites;
 
     static CCGIFAnimatedSprite* create(const char* pszFileName) {
-        CCGIFAnimatedSprite* sprite = new CCGIFAnimatedSprite();
-        if (sprite and sprite->initWithGIFFile(pszFileName)) {
-            sprite->autorelease();
-            return sprite;
-        }
-        CC_SAFE_DELETE(sprite);
-        return nullptr;
+        return createWithOptions(pszFileName, s_defaultLoadOptions);
+    }
+
+    GIF_SPRITES_DLL static CCGIFAnimatedSprite* createWithOptions(const char* pszFileName, CCGIFLoadOptions const& options);
+    GIF_SPRITES_DLL static CCGIFAnimatedSprite* createAsync(const char* pszFileName, CCGIFLoadOptions const& options, CCGIFLoadCallback callback = nullptr);
+    bool isLoading() const { return m_loadJob != nullptr; }
+    GIF_SPRITES_DLL static CCGIFInfo probe(const char* pszFileName);
+    GIF_SPRITES_DLL static void setDefaultLoadOptions(CCGIFLoadOptions const& options);
+    GIF_SPRITES_DLL static CCGIFLoadOptions getDefaultLoadOptions();
+
+    CCGIFAnimatedSprite() {
+        s_liveSprites.insert(this);
     }
 
     ~CCGIFAnimatedSprite() {
+        s_liveSprites.erase(this);
+        if (m_loadJob) m_loadJob->cancelled = true;
+        if (m_syncGroup) CCGIFSyncGroups::get()->leave(this);
         CC_SAFE_RELEASE(m_frames);
-        if (m_canvasBuffer) {
-            CC_SAFE_FREE(m_canvasBuffer);
-            m_canvasBuffer = nullptr;
-        }
-        if (m_previousBuffer) {
-            CC_SAFE_FREE(m_previousBuffer);
-            m_previousBuffer = nullptr;
-        }
-        if (m_globalColorMap) {
-            GifFreeMapObject(m_globalColorMap);
-            m_globalColorMap = nullptr;
-        }
+        CC_SAFE_RELEASE(m_paletteTexture);
+        CC_SAFE_RELEASE(m_staticTexture);
     }
 
-    bool initWithGIFFile(const char* pszFileName) {
+    bool initWithGIFFile(const char* pszFileName, CCGIFLoadOptions const& options = s_defaultLoadOptions) {
         if (!pszFileName) {
             log::error("GIF filename is null...");
             return false;
         }
 
         m_filename = string::pathToString(pszFileName); //i think its useless to
+        m_loadOptions = options;
+        m_loadStats = CCGIFLoadStats();
+        auto loadStart = CCGIFLoadTelemetry::Clock::now();
 
         unsigned long fileSize = 0;
         unsigned char* fileData = CCFileUtils::get()->getFileData(pszFileName, "rb", &fileSize);
+        m_loadStats.readMs = CCGIFLoadTelemetry::msSince(loadStart);
+        m_loadStats.fileBytes = fileSize;
         if (!fileData or fileSize == 0) {
             log::error("Failed to read GIF file: {}", pszFileName);
             if (fileData) CC_SAFE_FREE(fileData);
             return false;
         }
 
-        m_checksum = CCGIFCacheManager::get()->calculateChecksum(fileData, fileSize);
+        auto hashStart = CCGIFLoadTelemetry::Clock::now();
+        m_checksum = CCGIFCacheManager::calculateChecksum(fileData, fileSize);
+        m_loadStats.hashMs = CCGIFLoadTelemetry::msSince(hashStart);
 
         //check cache first
-        CCGIFCacheData* cachedData = CCGIFCacheManager::get()->getCachedGIF(m_filename, m_checksum);
-        if (cachedData) {
-            bool success = initWithCachedData(cachedData);
-            CC_SAFE_FREE(fileData);
-            return success;
-        }
-
-        struct GifMemoryData {
-            unsigned char* data;
-            unsigned long size;
-            unsigned long position;
-        };
-        GifMemoryData memData = { fileData, fileSize, 0 };
-
-        auto inputFunc = [](GifFileType* gif, GifByteType* buf, int count)
-            {
-                GifMemoryData* memData = static_cast<GifMemoryData*>(gif->UserData);
-                if (!memData or !buf) return 0;
-
-                int bytesToRead = count;
-                if (memData->position + bytesToRead > memData->size) {
-                    bytesToRead = memData->size - memData->position;
-                }
-
-                if (bytesToRead <= 0) return 0;
-
-                memcpy(buf, memData->data + memData->position, bytesToRead);
-                memData->position += bytesToRead;
-                return bytesToRead;
-            };
-
-        int error = 0;
-        GifFileType* gifFile = DGifOpen(&memData, inputFunc, &error);
-        if (!gifFile) {
-            log::error("Failed to open GIF file at {}: {}", pszFileName, GifErrorString(error));
-            CC_SAFE_FREE(fileData);
-            return false;
+        auto cache = CCGIFCacheManager::get();
+        auto key = cacheChecksum(m_checksum, m_loadOptions);
+        auto cached = cache->getCachedGIF(m_filename, key);
+
+        //a preload worker decoding this exact gif right now is at least as far along as we would be
+        std::shared_ptr<CCGIFCacheManager::InFlight> flight;
+        if (!cached and !cache->beginLoad(CCGIFCacheManager::makeKey(m_filename, key), flight)) {
+            auto waitStart = CCGIFLoadTelemetry::Clock::now();
+            if (auto decoded = cache->waitFor(flight)) {
+                cached = publishDecoded(m_filename, m_checksum, m_loadOptions, INT_MAX, decoded, flight->stats, copySource(fileData, fileSize), nullptr);
+            }
+            m_loadStats.decodeMs = CCGIFLoadTelemetry::msSince(waitStart); //the wait is what decoding cost us
+            //their decode failed, ours wont do better but gets the usual error logs
+            flight = nullptr;
         }
 
-        //read all gif data...
-        if (DGifSlurp(gifFile) == GIF_ERROR) {
-            log::error("Failed to read GIF data from {}: {}", pszFileName, GifErrorString(gifFile->Error));
-            DGifCloseFile(gifFile);
+        if (cached) {
+            bool success = initWithCachedData(cached);
             CC_SAFE_FREE(fileData);
-            return false;
+            m_loadStats.fromCache = true;
+            if (success) finishLoadStats(loadStart);
+            return success;
         }
 
-        bool success = processGIFData(gifFile);
+        bool success = processGIFData(fileData, fileSize);
 
-        DGifCloseFile(gifFile);
+        //cache the processed data pls
+        if (success) cacheProcessedData(copySource(fileData, fileSize));
         CC_SAFE_FREE(fileData);
+        //anyone who waited on us finds it in the cache now
+        if (flight) cache->endLoad(flight);
 
         if (!success) {
             log::error("Failed to process GIF data from {}", pszFileName);
             return false;
         }
 
-        //cache the processed data pls
-        cacheProcessedData();
+        if (m_staticTexture) {
+            initWithTexture(m_staticTexture, canvasRect());
+            applyIndexedShader();
+            finishLoadStats(loadStart);
+            return true;
+        }
 
         //init with first frame if available
         if (m_frames and m_frames->count() > 0) {
             GIFFrame* firstFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(0));
             if (firstFrame and firstFrame->m_texture) {
-                initWithTexture(firstFrame->m_texture);
-                scheduleUpdate();
+                initWithTexture(firstFrame->m_texture, canvasRect());
+                applyIndexedShader();
+                startPlayback();
+                finishLoadStats(loadStart);
                 return true;
             }
         }
@@ -286,7 +615,38 @@ public: //anyways its internal impl, why to private members
         return false;
     }
 
-    bool initWithCachedData(CCGIFCacheData* cachedData) {
+    //async sprites are already placed and styled by now, only texture and rect may change
+    void initWithFirstTexture(CCTexture2D* texture) {
+        if (!m_loadJob) {
+            initWithTexture(texture, canvasRect());
+            return;
+        }
+        setTexture(texture);
+        CCSprite::setTextureRect(canvasRect());
+    }
+
+    bool initWithCachedData(CCGIFCacheManager::Entry const& cached) {
+        CCGIFCacheData* cachedData = cached.get();
+        //textures went away under memory pressure, this sprite needs them now
+        if (cachedData and cachedData->evicted) restoreCacheData(cached, true);
+        if (cachedData) cachedData->used = true;
+        m_cacheEntry = cached;
+
+        if (cachedData and cachedData->staticTexture) {
+            m_canvasWidth = cachedData->canvasWidth;
+            m_canvasHeight = cachedData->canvasHeight;
+            m_hasTransparentBackground = cachedData->hasTransparentBackground;
+            m_isOpaque = cachedData->isOpaque;
+            m_paletteTexture = cachedData->paletteTexture;
+            CC_SAFE_RETAIN(m_paletteTexture);
+            m_staticTexture = cachedData->staticTexture;
+            m_staticTexture->retain();
+
+            initWithFirstTexture(m_staticTexture);
+            applyIndexedShader();
+            return true;
+        }
+
         if (!cachedData or !cachedData->frames or cachedData->frames->count() == 0) {
             log::error("Failed to create GIF sprite from cached data.");
             log::error("{}->cachedData = {}", this, cachedData);
@@ -300,42 +660,21 @@ public: //anyways its internal impl, why to private members
         m_canvasWidth = cachedData->canvasWidth;
         m_canvasHeight = cachedData->canvasHeight;
         m_hasTransparentBackground = cachedData->hasTransparentBackground;
+        m_isOpaque = cachedData->isOpaque;
+        m_paletteTexture = cachedData->paletteTexture;
+        CC_SAFE_RETAIN(m_paletteTexture);
 
-        //alloc canvas buffers
-        size_t canvasSize = m_canvasWidth * m_canvasHeight * 4; //rgba
-        m_canvasBuffer = static_cast<GifByteType*>(malloc(canvasSize));
-        m_previousBuffer = static_cast<GifByteType*>(malloc(canvasSize));
-
-        if (!m_canvasBuffer or !m_previousBuffer) {
-            log::error("Failed to allocate canvas buffers.");
-            return false;
-        }
-
-        initializeCanvas();
-
-        //copy frames from cache
-        m_frames = CCArray::create();
+        //same frame objects as the cache, textures a preload is still uploading show up here too
+        m_frames = CCArray::createWithArray(cachedData->frames);
         m_frames->retain();
 
-        for (unsigned int i = 0; i < cachedData->frames->count(); i++) {
-            GIFFrame* cachedFrame = typeinfo_cast<GIFFrame*>(cachedData->frames->objectAtIndex(i));
-            if (cachedFrame) {
-                GIFFrame* frameCopy = cachedFrame->copy();
-                m_frames->addObject(frameCopy);
-                frameCopy->release();
-            }
-        }
-
-        if (m_frames->count() == 0) {
-            log::error("No frames copied from cache");
-            return false;
-        }
-
-        //init with first frame
+        //init with first frame, it cant wait for its turn in the upload queue
         GIFFrame* firstFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(0));
+        if (firstFrame and !firstFrame->m_texture) requireTexture(firstFrame);
         if (firstFrame and firstFrame->m_texture) {
-            initWithTexture(firstFrame->m_texture);
-            scheduleUpdate();
+            initWithFirstTexture(firstFrame->m_texture);
+            applyIndexedShader();
+            startPlayback();
             log::debug(
                 "Successfully initialized GIF from cache for {} ({} frames)",
                 m_filename, m_frames->count()
@@ -346,8 +685,63 @@ public: //anyways its internal impl, why to private members
         return false;
     }
 
-    void cacheProcessedData() {
-        if (!m_frames or m_frames->count() == 0) return; //ok
+    void finishLoadStats(CCGIFLoadTelemetry::Clock::time_point loadStart) {
+        m_loadStats.totalMs = CCGIFLoadTelemetry::msSince(loadStart);
+        m_loadStats.frameCount = getFrameCount();
+        m_loadStats.textureBytes = framesTextureBytes(m_frames) + textureBytes(m_paletteTexture) + textureBytes(m_staticTexture);
+        CCGIFLoadTelemetry::get()->record(m_loadStats);
+
+        log::debug(
+            "GIF load {}: {:.2f}ms total{} (read {:.2f}, hash {:.2f}, decode {:.2f}, composite {:.2f}, upload {:.2f}), {} bytes -> {} frames ({} duplicates merged), {} texture bytes",
+            m_filename, m_loadStats.totalMs, m_loadStats.fromCache ? " from cache" : "",
+            m_loadStats.readMs, m_loadStats.hashMs, m_loadStats.decodeMs, m_loadStats.compositeMs, m_loadStats.uploadMs,
+            m_loadStats.fileBytes, m_loadStats.frameCount, m_loadStats.duplicateFrames, m_loadStats.textureBytes
+        );
+    }
+
+    //what gl keeps per pixel. not bitsPerPixelForFormat(), cocos says 32 for RGB888 there
+    static size_t bytesPerPixel(CCTexture2DPixelFormat format) {
+        switch (format) {
+        case kCCTexture2DPixelFormat_RGB888: return 3;
+        case kCCTexture2DPixelFormat_RGB565:
+        case kCCTexture2DPixelFormat_RGBA4444:
+        case kCCTexture2DPixelFormat_RGB5A1:
+        case kCCTexture2DPixelFormat_AI88: return 2;
+        case kCCTexture2DPixelFormat_A8:
+        case kCCTexture2DPixelFormat_I8: return 1;
+        default: return 4; //RGBA8888, gifs are never uploaded compressed
+        }
+    }
+
+    static size_t textureBytes(CCTexture2D* texture) {
+        if (!texture) return 0;
+        size_t bytes = (size_t)texture->getPixelsWide() * texture->getPixelsHigh() * bytesPerPixel(texture->getPixelFormat());
+        return texture->hasMipmaps() ? bytes * 4 / 3 : bytes; //mip chain adds a third
+    }
+
+    static size_t framesTextureBytes(CCArray* frames) {
+        size_t bytes = 0;
+        if (!frames) return bytes;
+        for (unsigned int i = 0; i < frames->count(); i++) {
+            if (auto frame = typeinfo_cast<GIFFrame*>(frames->objectAtIndex(i))) bytes += textureBytes(frame->m_texture);
+        }
+        return bytes;
+    }
+
+    //frame objects + array storage, textures are counted separately
+    static size_t framesCpuBytes(CCArray* frames) {
+        if (!frames) return 0;
+        return (size_t)frames->count() * (sizeof(GIFFrame) + sizeof(CCObject*)) + sizeof(CCArray);
+    }
+
+    CCGIFLoadStats const& getLoadStats() const { return m_loadStats; }
+    GIF_SPRITES_DLL static CCGIFLoadHistogram getLoadHistogram();
+    GIF_SPRITES_DLL static void resetLoadHistogram();
+    GIF_SPRITES_DLL static CCGIFMemoryReport getMemoryReport();
+    GIF_SPRITES_DLL static void logMemoryReport();
+
+    void cacheProcessedData(std::shared_ptr<const std::vector<unsigned char>> source) {
+        if (!m_staticTexture and (!m_frames or m_frames->count() == 0)) return; //ok
 
         CCGIFCacheData* cacheData = CCGIFCacheData::create();
         if (!cacheData) {
@@ -359,364 +753,653 @@ public: //anyways its internal impl, why to private members
         cacheData->canvasWidth = m_canvasWidth;
         cacheData->canvasHeight = m_canvasHeight;
         cacheData->hasTransparentBackground = m_hasTransparentBackground;
+        cacheData->isOpaque = m_isOpaque;
         cacheData->checksum = m_checksum;
+        cacheData->options = m_loadOptions;
+        cacheData->source = std::move(source);
+        cacheData->used = true;
+        cacheData->paletteTexture = m_paletteTexture;
+        CC_SAFE_RETAIN(cacheData->paletteTexture);
+
+        if (m_staticTexture) {
+            cacheData->staticTexture = m_staticTexture;
+            m_staticTexture->retain();
+            m_cacheEntry = CCGIFCacheManager::get()->cacheGIF(m_filename, cacheChecksum(m_checksum, m_loadOptions), cacheData);
+            return;
+        }
 
-        //copy frames for caching
-        cacheData->frames = CCArray::create();
+        //frames are only changed after load by releaseUnusedFrames() and restores, cache and sprites share them
+        cacheData->frames = CCArray::createWithArray(m_frames);
         cacheData->frames->retain();
 
-        for (unsigned int i = 0; i < m_frames->count(); i++) {
-            GIFFrame* frame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(i));
-            if (frame) {
-                GIFFrame* frameCopy = frame->copy();
-                cacheData->frames->addObject(frameCopy);
-                frameCopy->release();
-            }
-        }
+        m_cacheEntry = CCGIFCacheManager::get()->cacheGIF(m_filename, cacheChecksum(m_checksum, m_loadOptions), cacheData);
+    }
 
-        CCGIFCacheManager::get()->cacheGIF(m_filename, m_checksum, cacheData);
+    static std::shared_ptr<const std::vector<unsigned char>> copySource(const unsigned char* data, unsigned long size) {
+        return std::make_shared<const std::vector<unsigned char>>(data, data + size);
     }
 
-    bool processGIFData(GifFileType* gifFile) {
-        if (!gifFile or gifFile->ImageCount <= 0) {
-            log::error("Invalid GIF file or no images");
-            return false;
+    //same file loaded with other options is a different cache entry
+    static std::string cacheChecksum(const std::string& checksum, CCGIFLoadOptions const& options) {
+        auto key = fmt::format("{}_f{}", checksum, static_cast<int>(options.pixelFormat));
+        if (options.maxTextureSize or options.maxScale > 0.f) key += fmt::format("_s{}x{}", options.maxTextureSize, options.maxScale);
+        if (options.mipmaps) key += "_mip";
+        return key;
+    }
+
+    //maps requested format onto what the content allows
+    static CCTexture2DPixelFormat resolvePixelFormat(CCGIFPixelFormat requested, bool isOpaque, gifcore::PixelConverter::PaletteFit const& fit) {
+        switch (requested) {
+        case CCGIFPixelFormat::RGBA8888:
+            return kCCTexture2DPixelFormat_RGBA8888;
+        case CCGIFPixelFormat::RGBA4444:
+            return kCCTexture2DPixelFormat_RGBA4444;
+        case CCGIFPixelFormat::RGB5A1:
+            return kCCTexture2DPixelFormat_RGB5A1;
+        case CCGIFPixelFormat::RGB565:
+            if (isOpaque) return kCCTexture2DPixelFormat_RGB565;
+            log::warn("RGB565 requested for GIF with transparency, using RGB5A1");
+            return kCCTexture2DPixelFormat_RGB5A1;
+        case CCGIFPixelFormat::RGB888:
+            if (isOpaque) return kCCTexture2DPixelFormat_RGB888;
+            log::warn("RGB888 requested for GIF with transparency, using RGBA8888");
+            return kCCTexture2DPixelFormat_RGBA8888;
+        case CCGIFPixelFormat::AutoLossy:
+            return isOpaque ? kCCTexture2DPixelFormat_RGB565 : kCCTexture2DPixelFormat_RGB5A1;
+        case CCGIFPixelFormat::Auto:
+        case CCGIFPixelFormat::Indexed: //only gets here when gif didnt fit one palette
+        default:
+            switch (gifcore::PixelConverter::autoFormat(isOpaque, fit)) {
+            case gifcore::PixelConverter::Format::RGB565: return kCCTexture2DPixelFormat_RGB565;
+            case gifcore::PixelConverter::Format::RGB5A1: return kCCTexture2DPixelFormat_RGB5A1;
+            case gifcore::PixelConverter::Format::RGBA4444: return kCCTexture2DPixelFormat_RGBA4444;
+            case gifcore::PixelConverter::Format::RGB888: return kCCTexture2DPixelFormat_RGB888;
+            default: return kCCTexture2DPixelFormat_RGBA8888;
+            }
         }
+    }
 
-        m_canvasWidth = gifFile->SWidth;
-        m_canvasHeight = gifFile->SHeight;
+    //how every canvas of one gif goes up to the gpu
+    struct UploadTarget {
+        CCTexture2DPixelFormat format = kCCTexture2DPixelFormat_RGBA8888;
+        GifWord width = 0; //texture size, below the canvas size when downscaled
+        GifWord height = 0;
+        bool mipmaps = false;
+    };
 
-        if (m_canvasWidth == 0 or m_canvasHeight == 0) {
-            log::error("Invalid GIF canvas dimensions: {}x{}", m_canvasWidth, m_canvasHeight);
-            return false;
+    static UploadTarget makeUploadTarget(
+        CCGIFLoadOptions const& options, GifWord canvasWidth, GifWord canvasHeight,
+        bool indexed, bool isOpaque, gifcore::PixelConverter::PaletteFit fit
+    ) {
+        UploadTarget target;
+        gifcore::Resampler::targetSize(canvasWidth, canvasHeight, options.maxTextureSize, options.maxScale, target.width, target.height);
+        bool downscaled = target.width != canvasWidth or target.height != canvasHeight;
+        //filtered colors are no palette colors anymore, a 16 bit format wouldnt be lossless
+        if (downscaled) fit = { false, false, false };
+        target.format = indexed ? kCCTexture2DPixelFormat_A8 : resolvePixelFormat(options.pixelFormat, isOpaque, fit);
+
+        //gles2 only mipmaps power of two textures, and indices must never be filtered
+        auto pot = [](GifWord v) { return v > 0 and (v & (v - 1)) == 0; };
+        target.mipmaps = options.mipmaps and !indexed and pot(target.width) and pot(target.height);
+        if (options.mipmaps and !target.mipmaps) {
+            log::debug("No mipmaps for {}x{} GIF textures (indexed or not a power of two)", target.width, target.height);
         }
+        if (downscaled) {
+            log::debug("Downscaling {}x{} GIF to {}x{} textures", canvasWidth, canvasHeight, target.width, target.height);
+        }
+        return target;
+    }
 
-        //alloc canvas buff
-        size_t canvasSize = m_canvasWidth * m_canvasHeight * 4; //rgba
-        m_canvasBuffer = static_cast<GifByteType*>(malloc(canvasSize));
-        m_previousBuffer = static_cast<GifByteType*>(malloc(canvasSize));
+    //texture rect covering the whole gif, in canvas size even when the texture is downscaled
+    CCRect canvasRect() const {
+        return CCRectMake(0, 0, m_canvasWidth / CC_CONTENT_SCALE_FACTOR(), m_canvasHeight / CC_CONTENT_SCALE_FACTOR());
+    }
 
-        if (!m_canvasBuffer or !m_previousBuffer) {
-            log::error("Failed to allocate canvas buffers");
-            return false;
-        }
+    //rects stay in canvas space so layout doesnt depend on maxTextureSize/maxScale,
+    //a downscaled texture gets the quad at canvas size and samples the matching smaller rect
+    virtual void setTextureRect(const CCRect& rect, bool rotated, const CCSize& untrimmedSize) override {
+        CCSprite::setTextureRect(rect, rotated, untrimmedSize);
+
+        auto texture = getTexture();
+        if (!texture or m_canvasWidth <= 0 or m_canvasHeight <= 0) return;
+        float sx = (float)texture->getPixelsWide() / m_canvasWidth;
+        float sy = (float)texture->getPixelsHigh() / m_canvasHeight;
+        if (sx == 1.f and sy == 1.f) return;
+        setTextureCoords(CCRectMake(rect.origin.x * sx, rect.origin.y * sy, rect.size.width * sx, rect.size.height * sy));
+    }
 
-        //store global color map
-        if (gifFile->SColorMap) {
-            m_globalColorMap = GifMakeMapObject(gifFile->SColorMap->ColorCount, gifFile->SColorMap->Colors);
-            if (!m_globalColorMap) {
-                log::error("Failed to copy global color map");
-                return false;
-            }
-        }
+    bool processGIFData(const unsigned char* fileData, unsigned long fileSize) {
+        gifcore::Decoder decoder;
+        forwardDecoderLog(decoder);
+
+        //upload every frame straight from the decoder canvas
+        UploadTarget target;
+        decoder.m_requestIndexed = m_loadOptions.pixelFormat == CCGIFPixelFormat::Indexed;
+        float uploadMs = 0.f;
+        bool firstFrame = true;
+        bool success = decoder.decode(fileData, fileSize, m_filename, [&](const gifcore::FrameInfo& info, const GifByteType* canvas) {
+            auto uploadStart = CCGIFLoadTelemetry::Clock::now();
+            auto countUpload = [&](bool result) {
+                uploadMs += CCGIFLoadTelemetry::msSince(uploadStart);
+                return result;
+            };
 
-        //check if any fucking frame has transparencyyyyyaa
-        m_hasTransparentBackground = false;
-        for (int i = 0; i < gifFile->ImageCount; i++) {
-            GraphicsControlBlock gcb;
-            if (DGifSavedExtensionToGCB(gifFile, i, &gcb) == GIF_OK) {
-                if (gcb.TransparentColor != NO_TRANSPARENT_COLOR) {
-                    m_hasTransparentBackground = true;
-                    break;
+            //decoder analyzed the whole file before the first frame comes out
+            if (firstFrame) {
+                firstFrame = false;
+                target = makeUploadTarget(
+                    m_loadOptions, decoder.m_canvasWidth, decoder.m_canvasHeight,
+                    decoder.m_indexed, decoder.m_isOpaque, decoder.m_paletteFit
+                );
+                if (decoder.m_indexed) {
+                    m_paletteTexture = createPaletteTexture(decoder.m_palette);
+                    if (!m_paletteTexture) return countUpload(false);
                 }
             }
-        }
-
-        initializeCanvas();
-
-        m_frames = CCArray::create();
-        m_frames->retain();
 
-        //process each frame
-        for (int i = 0; i < gifFile->ImageCount; i++) {
-            SavedImage* savedImage = &gifFile->SavedImages[i];
-            if (!savedImage or !savedImage->RasterBits) {
-                log::warn("Skipping invalid frame {}", i);
-                continue;
+            //static gif, plain texture without frame wrapper
+            if (decoder.m_imageCount == 1) {
+                m_staticTexture = createFrameTexture(canvas, decoder.m_canvasWidth, decoder.m_canvasHeight, target);
+                return countUpload(m_staticTexture != nullptr);
             }
 
-            GIFFrame* frame = new GIFFrame();
-            if (!processFrame(frame, savedImage, gifFile, i)) {
-                log::warn("Failed to process frame {}", i);
-                CC_SAFE_DELETE(frame);
-                continue;
+            //nothing changed since the last frame, just hold that one longer instead of uploading the same pixels again
+            if (info.duplicate and m_frames and m_frames->count() > 0) {
+                auto lastFrame = static_cast<GIFFrame*>(m_frames->lastObject());
+                lastFrame->m_delay += info.delay;
+                m_loadStats.duplicateFrames++;
+                return countUpload(true);
             }
 
+            if (!m_frames) {
+                m_frames = CCArray::create();
+                m_frames->retain();
+            }
+            GIFFrame* frame = createFrame(info, canvas, decoder.m_canvasWidth, decoder.m_canvasHeight, target);
+            if (!frame) return countUpload(false);
             m_frames->addObject(frame);
             frame->release(); //CCArray retains it
-        }
+            return countUpload(true);
+        });
+
+        m_loadStats.decodeMs = decoder.m_timings.lzw * 1000.f;
+        m_loadStats.compositeMs = (decoder.m_timings.composite + decoder.m_timings.disposal) * 1000.f;
+        m_loadStats.uploadMs = uploadMs;
 
-        if (m_frames->count() == 0) {
-            log::error("No valid frames processed");
+        m_canvasWidth = decoder.m_canvasWidth;
+        m_canvasHeight = decoder.m_canvasHeight;
+        m_hasTransparentBackground = decoder.m_hasTransparentBackground;
+        m_isOpaque = decoder.m_isOpaque;
+
+        if (!success or getFrameCount() == 0) {
             return false;
         }
 
         log::debug(
             "Successfully loaded GIF with {} frames ({}x{})",
-            m_frames->count(), m_canvasWidth, m_canvasHeight
+            getFrameCount(), m_canvasWidth, m_canvasHeight
         );
         return true;
     }
 
-    void initializeCanvas() {
-        if (!m_canvasBuffer) return;
-
-        size_t canvasSize = m_canvasWidth * m_canvasHeight * 4;
-
-        for (size_t i = 0; i < canvasSize; i += 4) {
-            m_canvasBuffer[i] = 0;
-            m_canvasBuffer[i + 1] = 0;
-            m_canvasBuffer[i + 2] = 0;
-            m_canvasBuffer[i + 3] = 0;
+    //main thread only, makes the texture
+    static GIFFrame* createFrame(const gifcore::FrameInfo& info, const GifByteType* canvas, GifWord width, GifWord height, UploadTarget const& target) {
+        GIFFrame* frame = createPendingFrame(info);
+        frame->m_texture = createFrameTexture(canvas, width, height, target);
+        if (!frame->m_texture) {
+            CC_SAFE_DELETE(frame);
+            return nullptr;
         }
+        return frame;
+    }
 
-        memcpy(m_previousBuffer, m_canvasBuffer, canvasSize);
+    //no texture yet, for CCGIFUploadQueue
+    static GIFFrame* createPendingFrame(const gifcore::FrameInfo& info) {
+        GIFFrame* frame = new GIFFrame();
+        frame->imageDesc = info.imageDesc;
+        frame->m_delay = info.delay;
+        frame->m_disposalMethod = info.disposalMethod;
+        frame->m_transparentColorIndex = info.transparentColorIndex;
+        return frame;
     }
 
-    bool processFrame(GIFFrame* frame, SavedImage* savedImage, GifFileType* gifFile, int frameIndex) {
-        if (!frame or !savedImage) return false;
+    //retained texture or nullptr
+    static CCTexture2D* createFrameTexture(const GifByteType* canvas, GifWord width, GifWord height, UploadTarget const& target) {
+        CCTexture2D* texture = createTextureFromCanvas(canvas, width, height, target);
+        if (!texture) {
+            log::error("Failed to create texture for GIF frame");
+            return nullptr;
+        }
 
-        frame->imageDesc = savedImage->ImageDesc;
-        frame->m_delay = 0.1f; //default delay
-        frame->m_disposalMethod = DISPOSE_DO_NOT;
-        frame->m_transparentColorIndex = NO_TRANSPARENT_COLOR;
+        texture->retain();
+        //indices must never be filtered
+        if (target.format == kCCTexture2DPixelFormat_A8) texture->setAliasTexParameters();
+        else if (target.mipmaps) {
+            texture->generateMipmap();
+            ccTexParams params = { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE };
+            texture->setTexParameters(&params);
+        }
+        return texture;
+    }
 
-        //parse graphics control block
-        GraphicsControlBlock gcb;
-        if (DGifSavedExtensionToGCB(gifFile, frameIndex, &gcb) == GIF_OK) {
-            frame->m_delay = gcb.DelayTime > 0 ? gcb.DelayTime / 100.0f : 0.1f;
-            frame->m_disposalMethod = gcb.DisposalMode;
-            frame->m_transparentColorIndex = gcb.TransparentColor;
+    //retained texture or nullptr
+    static CCTexture2D* createPaletteTexture(const gifcore::Palette& palette) {
+        CCTexture2D* texture = new CCTexture2D();
+        if (!texture->initWithData(palette.colors, kCCTexture2DPixelFormat_RGBA8888, 256, 1, CCSizeMake(256, 1))) {
+            log::error("Failed to create GIF palette texture");
+            CC_SAFE_DELETE(texture);
+            return nullptr;
         }
+        texture->setAliasTexParameters();
+        return texture;
+    }
 
-        //choose color map (local takes precedence over global)
-        ColorMapObject* colorMap = savedImage->ImageDesc.ColorMap 
-            ? savedImage->ImageDesc.ColorMap 
-            : m_globalColorMap;
+    static constexpr auto kIndexedShaderKey = "user95401.gif-sprites/indexed";
 
-        if (!colorMap) {
-            log::error("No color map available for frame {}", frameIndex);
-            return false;
-        }
+    //index texture on unit 0, palette on unit 1
+    static CCGLProgram* getIndexedShader() {
+        auto shaderCache = CCShaderCache::sharedShaderCache();
+        if (auto program = shaderCache->programForKey(kIndexedShaderKey)) return program;
 
-        //apply disposal method from previous frame BEFORE rendering current frame
-        if (frameIndex > 0) {
-            GIFFrame* prevFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(frameIndex - 1));
-            if (prevFrame) {
-                applyDisposalMethodForFrame(prevFrame);
-            }
+        auto program = new CCGLProgram();
+        if (!linkIndexedShader(program)) {
+            program->release();
+            return nullptr;
         }
+        shaderCache->addProgram(program, kIndexedShaderKey);
+        program->release();
+        return program;
+    }
 
-        //render current frame to canvas
-        if (!renderFrameToCanvas(savedImage, colorMap, frame->m_transparentColorIndex)) {
-            log::error("Failed to render frame {} to canvas", frameIndex);
+    //gl context came back without it. same CCGLProgram object, sprites keep pointing at it
+    static void reloadIndexedShader() {
+        auto program = CCShaderCache::sharedShaderCache()->programForKey(kIndexedShaderKey);
+        if (!program) return;
+        program->reset();
+        linkIndexedShader(program);
+    }
+
+    static bool linkIndexedShader(CCGLProgram* program) {
+        static constexpr auto vert = R"(
+attribute vec4 a_position;
+attribute vec2 a_texCoord;
+attribute vec4 a_color;
+#ifdef GL_ES
+varying lowp vec4 v_fragmentColor;
+varying mediump vec2 v_texCoord;
+#else
+varying vec4 v_fragmentColor;
+varying vec2 v_texCoord;
+#endif
+void main() {
+    gl_Position = CC_MVPMatrix * a_position;
+    v_fragmentColor = a_color;
+    v_texCoord = a_texCoord;
+}
+)";
+        static constexpr auto frag = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+varying vec4 v_fragmentColor;
+varying vec2 v_texCoord;
+uniform sampler2D u_palette;
+void main() {
+    float index = texture2D(CC_Texture0, v_texCoord).a;
+    gl_FragColor = v_fragmentColor * texture2D(u_palette, vec2((index * 255.0 + 0.5) / 256.0, 0.5));
+}
+)";
+
+        if (!program->initWithVertexShaderByteArray(vert, frag)) {
+            log::error("Failed to compile GIF indexed shader");
             return false;
         }
-
-        //create texture from current canvas state
-        frame->m_texture = createTextureFromCanvas();
-        if (!frame->m_texture) {
-            log::error("Failed to create texture for frame {}", frameIndex);
+        program->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
+        program->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
+        program->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
+        if (!program->link()) {
+            log::error("Failed to link GIF indexed shader");
             return false;
         }
-
-        frame->m_texture->retain();
-
+        program->updateUniforms();
+        program->use();
+        program->setUniformLocationWith1i(program->getUniformLocationForName("u_palette"), 1);
         return true;
     }
 
-    void applyDisposalMethodForFrame(GIFFrame* frame) {
-        if (!frame) return;
-
-        switch (frame->m_disposalMethod) {
-        case DISPOSE_BACKGROUND: //clear frame area to transparent
-            clearFrameAreaToTransparent(frame->imageDesc);
-            break;
-        case DISPOSE_PREVIOUS: //restore previous canvas state
-            memcpy(m_canvasBuffer, m_previousBuffer, m_canvasWidth * m_canvasHeight * 4);
-            break;
-        default: //other disposal methods are treated as DISPOSE_DO_NOT
-            break;
-        };
-    }
-
-    void clearFrameAreaToTransparent(const GifImageDesc& imageDesc) {
-        int left = imageDesc.Left;
-        int top = imageDesc.Top;
-        int width = imageDesc.Width;
-        int height = imageDesc.Height;
-
-        //clamp to canvas bounds
-        if (left < 0) { width += left; left = 0; }
-        if (top < 0) { height += top; top = 0; }
-        if (left + width > m_canvasWidth) width = m_canvasWidth - left;
-        if (top + height > m_canvasHeight) height = m_canvasHeight - top;
-
-        if (width <= 0 or height <= 0) return;
-
-        //clear area to transparent
-        for (int y = top; y < top + height; y++) {
-            for (int x = left; x < left + width; x++) {
-                int pixelIndex = (y * m_canvasWidth + x) * 4;
-                m_canvasBuffer[pixelIndex] = 0;
-                m_canvasBuffer[pixelIndex + 1] = 0;
-                m_canvasBuffer[pixelIndex + 2] = 0;
-                m_canvasBuffer[pixelIndex + 3] = 0;
-            }
-        }
+    void applyIndexedShader() {
+        if (!m_paletteTexture) return;
+        if (auto program = getIndexedShader()) setShaderProgram(program);
     }
 
-    bool renderFrameToCanvas(SavedImage* savedImage, ColorMapObject* colorMap, int transparentColorIndex) {
-        if (!savedImage or !savedImage->RasterBits or !colorMap) return false;
-
-        GifImageDesc& imageDesc = savedImage->ImageDesc;
-        int left = imageDesc.Left;
-        int top = imageDesc.Top;
-        int width = imageDesc.Width;
-        int height = imageDesc.Height;
+    virtual void draw() override {
+        if (m_textureLost) return;
+        if (m_paletteTexture) {
+            ccGLBindTexture2DN(1, m_paletteTexture->getName());
+            //the state cache skips the unit 0 bind in CCSprite::draw when the frame is already there,
+            //glActiveTexture would stay on unit 1 and the next raw texture call would hit the palette
+            glActiveTexture(GL_TEXTURE0);
+        }
 
-        //validate bounds
-        if (left < 0 or top < 0 or left + width > m_canvasWidth or top + height > m_canvasHeight) {
-            log::warn("Frame extends beyond canvas bounds: {}x{} at ({},{})", width, height, left, top);
-            //clamp to valid region
-            if (left < 0) { width += left; left = 0; }
-            if (top < 0) { height += top; top = 0; }
-            if (left + width > m_canvasWidth) width = m_canvasWidth - left;
-            if (top + height > m_canvasHeight) height = m_canvasHeight - top;
+        //ccGLBlendFunc turns GL_ONE/GL_ZERO into glDisable(GL_BLEND), saves the fill rate on big backgrounds.
+        //swapped only around this draw since setTexture resets blend func on every frame change,
+        //and left alone when faded or when someone set their own blend func
+        auto blend = getBlendFunc();
+        bool defaultBlend = (blend.src == GL_SRC_ALPHA and blend.dst == GL_ONE_MINUS_SRC_ALPHA)
+            or (blend.src == CC_BLEND_SRC and blend.dst == CC_BLEND_DST);
+        if (m_isOpaque and defaultBlend and getDisplayedOpacity() == 255) {
+            setBlendFunc({ GL_ONE, GL_ZERO });
+            CCSprite::draw();
+            setBlendFunc(blend);
+        }
+        else CCSprite::draw();
 
-            if (width <= 0 or height <= 0) return false;
+        if (m_paletteTexture) {
+            //nobody else expects a texture on unit 1, dont leave the palette there for them to overwrite
+            ccGLBindTexture2DN(1, 0);
+            glActiveTexture(GL_TEXTURE0);
         }
+    }
+
+    static CCTexture2D* createTextureFromCanvas(const GifByteType* canvas, GifWord width, GifWord height, UploadTarget const& target) {
+        if (!canvas) return nullptr;
 
-        //save current canvas state for DISPOSE_PREVIOUS
-        memcpy(m_previousBuffer, m_canvasBuffer, m_canvasWidth * m_canvasHeight * 4);
+        CCTexture2D* texture = new CCTexture2D();
+        if (!texture) return nullptr;
 
-        GifByteType* rasterBits = savedImage->RasterBits;
+        auto format = target.format;
+        CCGIFStagingPool::Buffer scaled;
+        if (target.width != width or target.height != height) {
+            //shrink first, format conversion below then only touches the small canvas
+            size_t bytesPerPixel = format == kCCTexture2DPixelFormat_A8 ? 1 : 4;
+            scaled.data = CCGIFStagingPool::get()->acquire((size_t)target.width * target.height * bytesPerPixel, scaled.capacity);
+            if (!scaled.data) {
+                CC_SAFE_DELETE(texture);
+                return nullptr;
+            }
+            auto dst = static_cast<GifByteType*>(scaled.data);
+            if (bytesPerPixel == 1) {
+                gifcore::Resampler::pointSample(canvas, width, height, 1, dst, target.width, target.height);
+            }
+            else {
+                CCGIFStagingPool::Buffer scratch;
+                if (size_t bytes = gifcore::Resampler::scratchBytes(width, height, target.width, target.height)) {
+                    scratch.data = CCGIFStagingPool::get()->acquire(bytes, scratch.capacity);
+                    if (!scratch.data) {
+                        CC_SAFE_DELETE(texture);
+                        return nullptr;
+                    }
+                }
+                gifcore::Resampler::downscaleRGBA(canvas, width, height, dst, target.width, target.height, static_cast<GifByteType*>(scratch.data));
+            }
+            canvas = dst;
+            width = target.width;
+            height = target.height;
+        }
 
-        //handle interlaced images
-        int* passHeights = nullptr;
-        int* passStarts = nullptr;
-        int passCount = 1;
+        size_t pixelCount = (size_t)width * height;
 
-        if (imageDesc.Interlace) {
-            static int interlaceOffsets[] = { 0, 4, 2, 1 };
-            static int interlaceJumps[] = { 8, 8, 4, 2 };
-            passCount = 4;
+        //canvas layout already matches RGBA8888/A8, gl copies it during initWithData
+        const void* textureData = canvas;
+        CCGIFStagingPool::Buffer staging;
 
-            passStarts = interlaceOffsets;
-            passHeights = interlaceJumps;
+        if (format == kCCTexture2DPixelFormat_RGB888) {
+            staging.data = CCGIFStagingPool::get()->acquire(pixelCount * 3, staging.capacity);
+            if (!staging.data) {
+                CC_SAFE_DELETE(texture);
+                return nullptr;
+            }
+            gifcore::PixelConverter::toRGB888(canvas, static_cast<GifByteType*>(staging.data), pixelCount);
+            textureData = staging.data;
         }
+        else if (format != kCCTexture2DPixelFormat_RGBA8888 and format != kCCTexture2DPixelFormat_A8) {
+            staging.data = CCGIFStagingPool::get()->acquire(pixelCount * 2, staging.capacity);
+            if (!staging.data) {
+                CC_SAFE_DELETE(texture);
+                return nullptr;
+            }
 
-        int rasterIndex = 0;
+            auto dst = static_cast<uint16_t*>(staging.data);
+            switch (format) {
+            case kCCTexture2DPixelFormat_RGBA4444:
+                gifcore::PixelConverter::toRGBA4444(canvas, dst, pixelCount);
+                break;
+            case kCCTexture2DPixelFormat_RGB5A1:
+                gifcore::PixelConverter::toRGB5A1(canvas, dst, pixelCount);
+                break;
+            default:
+                gifcore::PixelConverter::toRGB565(canvas, dst, pixelCount);
+                break;
+            }
+            textureData = staging.data;
+        }
 
-        for (int pass = 0; pass < passCount; pass++) {
-            int startRow = imageDesc.Interlace ? passStarts[pass] : 0;
-            int rowStep = imageDesc.Interlace ? passHeights[pass] : 1;
+        bool success = texture->initWithData(
+            textureData,
+            format,
+            width,
+            height,
+            CCSizeMake(width, height)
+        );
 
-            for (int y = startRow; y < height; y += rowStep) {
-                for (int x = 0; x < width; x++) {
-                    if (rasterIndex >= width * height) {
-                        log::error("Raster index out of bounds");
-                        return false;
-                    }
+        if (!success) {
+            CC_SAFE_DELETE(texture);
+            return nullptr;
+        }
 
-                    GifByteType colorIndex = rasterBits[rasterIndex++];
+        return texture;
+    }
 
-                    //skip transparent pixels - leave existing pixel
-                    if (transparentColorIndex != NO_TRANSPARENT_COLOR and colorIndex == transparentColorIndex) {
-                        continue;
-                    }
+    //builds cache entry out of preloaded cpu frames, main thread only.
+    //animated frames come back without textures, they go through CCGIFUploadQueue with target
+    static CCGIFCacheData* createCacheData(const gifcore::DecodedGIF& decoded, const std::string& checksum, CCGIFLoadOptions const& options, UploadTarget& target) {
+        CCGIFCacheData* cacheData = CCGIFCacheData::create();
+        if (!cacheData) return nullptr;
+
+        cacheData->canvasWidth = decoded.canvasWidth;
+        cacheData->canvasHeight = decoded.canvasHeight;
+        cacheData->hasTransparentBackground = decoded.hasTransparentBackground;
+        cacheData->isOpaque = decoded.isOpaque;
+        cacheData->checksum = checksum;
+        cacheData->options = options;
+
+        target = makeUploadTarget(
+            options, decoded.canvasWidth, decoded.canvasHeight,
+            decoded.indexed, decoded.isOpaque, decoded.paletteFit
+        );
+        if (decoded.indexed) {
+            cacheData->paletteTexture = createPaletteTexture(decoded.palette);
+            if (!cacheData->paletteTexture) return nullptr;
+        }
 
-                    //validate color index
-                    if (colorIndex >= colorMap->ColorCount) {
-                        log::warn("Color index {} out of range (max {})", colorIndex, colorMap->ColorCount - 1);
-                        continue;
-                    }
+        if (decoded.imageCount == 1 and decoded.pixels.size() == 1) {
+            cacheData->staticTexture = createFrameTexture(decoded.pixels[0].data(), decoded.pixelWidth, decoded.pixelHeight, target);
+            return cacheData->staticTexture ? cacheData : nullptr;
+        }
 
-                    GifColorType& color = colorMap->Colors[colorIndex];
+        cacheData->frames = CCArray::create();
+        cacheData->frames->retain();
+        for (size_t i = 0; i < decoded.frames.size(); i++) {
+            //frame i of the array is always decoded frame i, the upload queue relies on it
+            GIFFrame* frame = createPendingFrame(decoded.frames[i]);
+            cacheData->frames->addObject(frame);
+            frame->release();
+        }
 
-                    int canvasX = left + x;
-                    int canvasY = top + y;
-                    int pixelIndex = (canvasY * m_canvasWidth + canvasX) * 4;
+        return cacheData->frames->count() > 0 ? cacheData : nullptr;
+    }
 
-                    m_canvasBuffer[pixelIndex] = color.Red;
-                    m_canvasBuffer[pixelIndex + 1] = color.Green;
-                    m_canvasBuffer[pixelIndex + 2] = color.Blue;
-                    m_canvasBuffer[pixelIndex + 3] = 255; //opaque for non transparent pixels
-                }
-            }
+    //anchors playback to the clock and joins the tick set, animated sprites only
+    void startPlayback() {
+        if (m_loadOptions.synchronized and m_frames and m_frames->count() > 1) {
+            CCGIFSyncGroups::get()->join(this);
+            return;
         }
+        auto clock = CCGIFPlaybackClock::get();
+        m_frameStartTime = clock->m_time - m_frameTimer;
+        m_anchorFrame = m_currentFrame;
+        m_lastVisitTick = clock->m_tick;
+        m_dormant = false;
+        if (m_frames and m_frames->count() > 1) scheduleUpdate();
+    }
 
-        return true;
+    float frameDelay(unsigned int index) const {
+        //frames array only ever holds GIFFrame
+        return static_cast<GIFFrame*>(m_frames->objectAtIndex(index))->m_delay;
     }
 
-    CCTexture2D* createTextureFromCanvas() {
-        if (!m_canvasBuffer) return nullptr;
+    //shows the frame that belongs to the current clock time,
+    //walks on from the current frame so a normal tick looks at one or two frames.
+    //catchUp after a dormant stretch first drops the whole loops that passed meanwhile
+    void syncToClock(bool catchUp = false) {
+        if (!m_frames or m_frames->count() <= 1) return;
+        double now = CCGIFPlaybackClock::get()->m_time;
+
+        //paused, or frame changed from outside: playback goes on from there, paused time doesnt count
+        if (!m_isPlaying or m_currentFrame != m_anchorFrame) {
+            m_frameStartTime = now - m_frameTimer;
+            m_anchorFrame = m_currentFrame;
+            if (!m_isPlaying) return;
+        }
 
-        CCTexture2D* texture = new CCTexture2D();
-        if (!texture) return nullptr;
+        unsigned int count = m_frames->count();
+        unsigned int frame = m_currentFrame < count ? m_currentFrame : 0;
 
-        //create a copy of canvas data for texture
-        void* textureData = malloc(m_canvasWidth * m_canvasHeight * 4);
-        if (!textureData) {
-            CC_SAFE_DELETE(texture);
-            return nullptr;
+        double start = m_frameStartTime;
+        if (catchUp and m_loop and now - start > frameDelay(frame)) {
+            double duration = 0.0;
+            for (unsigned int i = 0; i < count; i++) duration += frameDelay(i);
+            double loops = duration > 0.0 ? std::floor((now - start) / duration) : 0.0;
+            start += loops * duration;
         }
 
-        memcpy(textureData, m_canvasBuffer, m_canvasWidth * m_canvasHeight * 4);
+        //frames are already composited into textures, no disposal to replay here
+        bool finished = false;
+        while (now - start >= frameDelay(frame)) {
+            if (frame + 1 >= count and !m_loop) {
+                finished = true;
+                start = now;
+                break;
+            }
+            start += frameDelay(frame);
+            frame = frame + 1 < count ? frame + 1 : 0;
+        }
 
-        bool success = texture->initWithData(
-            textureData,
-            kCCTexture2DPixelFormat_RGBA8888,
-            m_canvasWidth,
-            m_canvasHeight,
-            CCSizeMake(m_canvasWidth, m_canvasHeight)
-        );
+        //frame still in the upload queue: keep the current one and walk again next tick
+        if (!showFrame(frame)) return;
+        m_frameStartTime = start;
+        m_frameTimer = (float)(now - start);
+        if (finished) m_isPlaying = false;
+    }
 
-        CC_SAFE_FREE(textureData);
+    //texture swap only when the frame differs, sync groups call this for every member on a shared change.
+    //false while that frame has no texture yet, nothing changes then
+    bool showFrame(unsigned int frame) {
+        if (frame == m_currentFrame) return true;
 
-        if (!success) {
-            CC_SAFE_DELETE(texture);
-            return nullptr;
-        }
+        GIFFrame* nextFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(frame));
+        if (!nextFrame or !nextFrame->m_texture) return false;
 
-        return texture;
+        m_currentFrame = frame;
+        m_anchorFrame = frame;
+        setTexture(nextFrame->m_texture);
+        return true;
     }
 
     virtual void update(float dt) override {
-        if (!m_isPlaying or !m_frames or m_frames->count() <= 1) {
+        if (!m_frames or m_frames->count() <= 1) {
+            return;
+        }
+        if (m_syncGroup) { //group ticks for it
+            unscheduleUpdate();
             return;
         }
 
-        m_frameTimer += dt;
+        //not drawn last tick (hidden ancestor, off screen or faded out): leave the tick set
+        //instead of swapping textures nobody sees, visit() picks it up again
+        if (m_lastVisitTick + 1 < CCGIFPlaybackClock::get()->m_tick) {
+            unscheduleUpdate();
+            m_dormant = true;
+            return;
+        }
 
-        GIFFrame* currentFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(m_currentFrame));
-        if (currentFrame and m_frameTimer >= currentFrame->m_delay) {
-            m_frameTimer = 0.0f;
+        syncToClock();
+    }
 
-            // Apply disposal method for current frame before moving to next
-            applyDisposalMethodForFrame(currentFrame);
+    //points between the sprites bounding box and the screen, 0 when they touch
+    float offScreenDistance() {
+        auto size = getContentSize();
+        auto world = CCRectApplyAffineTransform(CCRectMake(0, 0, size.width, size.height), nodeToWorldTransform());
+        auto winSize = CCDirector::get()->getWinSize();
+        float dx = std::max({ 0.f, world.getMinX() - winSize.width, -world.getMaxX() });
+        float dy = std::max({ 0.f, world.getMinY() - winSize.height, -world.getMaxY() });
+        return dx + dy;
+    }
 
-            m_currentFrame++;
+    bool isOnScreen() {
+        if (!isVisible() or getDisplayedOpacity() == 0) return false;
+        return offScreenDistance() <= 0.f;
+    }
 
-            if (m_currentFrame >= m_frames->count()) {
-                if (m_loop) {
-                    m_currentFrame = 0;
-                    // Reset canvas to initial state for looping
-                    initializeCanvas();
-                }
-                else {
-                    m_currentFrame = m_frames->count() - 1;
-                    m_isPlaying = false;
-                    return;
-                }
-            }
+    //background decode order: sprites on screen, other sprites (closest to the screen first), then preloads
+    enum LoadBand { kPreloadBand = 0, kSpriteBand = 1, kVisibleBand = 2 };
+    static int loadPriority(LoadBand band, int within) {
+        return band * (1 << 24) + std::clamp(within, -(1 << 23), (1 << 23) - 1);
+    }
 
-            // Re-render current frame
-            GIFFrame* nextFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(m_currentFrame));
-            if (nextFrame and nextFrame->m_texture) {
-                setTexture(nextFrame->m_texture);
+    //cocos only visits nodes whose ancestors are all visible, so getting here is most of the visibility check
+    virtual void visit() override {
+        if (m_textureLost and isOnScreen()) refreshTexture();
+        if (m_loadJob) {
+            int distance = isVisible() ? (int)std::min(offScreenDistance(), 1e7f) : INT_MAX;
+            m_loadJob->priority = distance == 0 ? loadPriority(kVisibleBand, 0) : loadPriority(kSpriteBand, -distance);
+        }
+        if (m_frames and m_frames->count() > 1 and isOnScreen()) {
+            m_lastVisitTick = CCGIFPlaybackClock::get()->m_tick;
+            //frames were dropped while it was out of sight, the current one stays up until they are back
+            if (m_cacheEntry and m_cacheEntry->evicted) restoreCacheData(m_cacheEntry, false);
+            if (m_dormant and m_syncGroup) {
+                //group went on without it, back to receiving changes and onto the shared frame
+                m_dormant = false;
+                m_syncGroup->active.insert(this);
+                if (m_isPlaying) showFrame(m_syncGroup->currentFrame);
+            }
+            else if (m_dormant) {
+                //back in view, jump to the frame it would be on by now before this draw
+                m_dormant = false;
+                syncToClock(true);
+                scheduleUpdate();
             }
         }
+        CCSprite::visit();
+    }
+
+    //picks up the texture of the current frame once its rebuilt after a context loss
+    void refreshTexture() {
+        if (!m_cacheEntry) {
+            m_textureLost = false;
+            return;
+        }
+        if (m_cacheEntry->evicted) {
+            restoreCacheData(m_cacheEntry, false);
+            return;
+        }
+
+        CCTexture2D* texture = nullptr;
+        if (m_staticTexture) {
+            texture = m_cacheEntry->staticTexture;
+            CC_SAFE_RETAIN(texture);
+            CC_SAFE_RELEASE(m_staticTexture);
+            m_staticTexture = texture;
+        }
+        else if (m_frames and m_currentFrame < m_frames->count()) {
+            auto frame = static_cast<GIFFrame*>(m_frames->objectAtIndex(m_currentFrame));
+            if (!frame->m_texture) requireTexture(frame);
+            texture = frame->m_texture;
+        }
+        if (!texture) return;
+        setTexture(texture);
+        m_textureLost = false;
     }
 
     void play() { m_isPlaying = true; }
@@ -725,15 +1408,21 @@ public: //anyways its internal impl, why to private members
     void setLoop(bool loop) { m_loop = loop; }
     bool isPlaying() const { return m_isPlaying; }
     unsigned int getCurrentFrame() const { return m_currentFrame; }
-    unsigned int getFrameCount() const { return m_frames ? m_frames->count() : 0; }
+    unsigned int getFrameCount() const { return m_frames ? m_frames->count() : (m_staticTexture ? 1 : 0); }
+
+    GIF_SPRITES_DLL void setSynchronized(bool synchronized);
+    bool isSynchronized() const { return m_syncGroup != nullptr; }
 
     void setCurrentFrame(unsigned int frame) {
         if (!m_frames or frame >= m_frames->count()) return;
 
         m_currentFrame = frame;
         m_frameTimer = 0.0f;
+        m_frameStartTime = CCGIFPlaybackClock::get()->m_time;
+        m_anchorFrame = frame;
 
         GIFFrame* targetFrame = typeinfo_cast<GIFFrame*>(m_frames->objectAtIndex(frame));
+        if (targetFrame and !targetFrame->m_texture) requireTexture(targetFrame);
         if (targetFrame and targetFrame->m_texture) {
             setTexture(targetFrame->m_texture);
         }
@@ -742,6 +1431,7 @@ public: //anyways its internal impl, why to private members
     //cache management methods
     static void purgeCachedGIFs() {
         CCGIFCacheManager::get()->purgeCache();
+        CCGIFStagingPool::get()->purge();
     }
     static void removeCachedGIF(const char* filename) {
         if (filename) CCGIFCacheManager::get()->removeGIF(std::string(filename));
@@ -751,12 +1441,856 @@ public: //anyways its internal impl, why to private members
     }
     static void logCacheStats() {
         CCGIFCacheManager::get()->logCacheStats();
+
+        auto pool = CCGIFStagingPool::get()->getStats();
+        log::debug(
+            "GIF staging pool: {} acquires, {} reuses, {} allocations, {} discards, {} bytes held (peak {})",
+            pool.acquires, pool.reuses, pool.allocations, pool.discards, pool.bytesHeld, pool.peakBytesHeld
+        );
     }
 
+    //decode a batch of gifs in background and put them into cache
+    GIF_SPRITES_DLL static void preload(std::vector<std::string> const& paths, int priority = 0, CCGIFPreloadCallback callback = nullptr);
+    GIF_SPRITES_DLL static void setUploadBudget(float milliseconds, size_t bytes = 0);
+    GIF_SPRITES_DLL static CCGIFUploadStats getUploadStats();
+    //uploads a queued frame now instead of on its turn
+    static void requireTexture(GIFFrame* frame);
+    //caches a worker decoded gif and queues its frame uploads, main thread. null if nothing could be uploaded,
+    //else onLoaded runs once the last frame is on the gpu
+    static CCGIFCacheManager::Entry publishDecoded(const std::string& filename, const std::string& checksum, CCGIFLoadOptions const& options,
+        int priority, std::shared_ptr<gifcore::DecodedGIF> decoded, CCGIFLoadStats stats,
+        std::shared_ptr<const std::vector<unsigned char>> source, std::function<void()> onLoaded);
+    GIF_SPRITES_DLL static size_t releaseUnusedFrames();
+    //brings back what releaseUnusedFrames() dropped. wait decodes right here for a sprite that needs it this frame,
+    //else a worker decodes and the frames go through CCGIFUploadQueue
+    static void restoreCacheData(CCGIFCacheManager::Entry const& entry, bool wait);
+    static void uploadRestored(CCGIFCacheData* data, std::shared_ptr<gifcore::DecodedGIF> decoded);
+    //cache entries plus the ones only sprites still hold, main thread
+    static std::unordered_set<CCGIFCacheData*> allCacheData();
+    //gl context loss: forgetTextures() before cocos reloads its own textures, reloadTextures() after
+    static void forgetTextures();
+    static void reloadTextures();
+
     //get cache info for this sprite
     const std::string& getFilename() const { return m_filename; }
     const std::string& getChecksum() const { return m_checksum; }
 };
+//include/CCGIFAnimatedSprite.hpp mirrors this layout for api users, its static_asserted there against the same struct
+static_assert(sizeof(CCGIFAnimatedSprite) == sizeof(CCGIFAnimatedSpriteLayout), "member added here but not to CCGIFAnimatedSpriteLayout and the header mirror");
+
+//preloaded gifs go up to the gpu a budget worth of frames per tick instead of all at once,
+//first frames of every gif before later ones. main thread only, ticks only while something is queued
+class CCGIFUploadQueue : public CCObject {
+public:
+    //one preloaded gif with frames still waiting
+    struct PendingGIF {
+        std::shared_ptr<gifcore::DecodedGIF> decoded;
+        CCGIFAnimatedSprite::UploadTarget target;
+        CCGIFLoadStats stats;
+        size_t remaining = 0;
+        std::function<void(PendingGIF&)> onUploaded; //after its last frame, uploaded or not
+    };
+
+    struct PendingFrame {
+        Ref<CCGIFAnimatedSprite::GIFFrame> frame;
+        std::shared_ptr<PendingGIF> gif;
+        size_t index = 0; //into gif->decoded
+    };
+
+    inline static CCGIFUploadQueue* s_sharedInstance = nullptr;
+    gifcore::UploadQueue<PendingFrame> m_queue;
+    bool m_scheduled = false;
+
+    static CCGIFUploadQueue* get() {
+        if (!s_sharedInstance) s_sharedInstance = new CCGIFUploadQueue();
+        return s_sharedInstance;
+    }
+
+    //frames[i] is filled from gif->decoded->pixels[i], needed at the time it shows up in playback
+    void push(std::shared_ptr<PendingGIF> const& gif, CCArray* frames, int priority) {
+        size_t bytes = (size_t)gif->target.width * gif->target.height * CCGIFAnimatedSprite::bytesPerPixel(gif->target.format);
+
+        double neededAt = 0.0;
+        for (unsigned int i = 0; i < frames->count(); i++) {
+            auto frame = static_cast<CCGIFAnimatedSprite::GIFFrame*>(frames->objectAtIndex(i));
+            m_queue.push({ Ref<CCGIFAnimatedSprite::GIFFrame>(frame), gif, i }, priority, neededAt, bytes);
+            neededAt += frame->m_delay;
+        }
+        gif->remaining += frames->count();
+
+        if (!m_scheduled) {
+            m_scheduled = true;
+            //after the playback clock, before sprite updates, so a frame uploaded this tick can show this tick
+            CCDirector::get()->getScheduler()->scheduleUpdateForTarget(this, INT_MIN + 2, false);
+        }
+    }
+
+    gifcore::UploadResult upload(PendingFrame& pending) {
+        auto& gif = *pending.gif;
+        auto result = gifcore::UploadResult::Dropped;
+        //a sync create or restore of the same entry already made it
+        if (pending.frame->m_texture) result = gifcore::UploadResult::Skipped;
+        //only the queue holds it: cache entry went away and no sprite uses the gif
+        else if (pending.frame->retainCount() > 1) {
+            auto uploadStart = CCGIFLoadTelemetry::Clock::now();
+            auto texture = CCGIFAnimatedSprite::createFrameTexture(
+                gif.decoded->pixels[pending.index].data(), gif.decoded->pixelWidth, gif.decoded->pixelHeight, gif.target
+            );
+            pending.frame->m_texture = texture;
+            gif.stats.uploadMs += CCGIFLoadTelemetry::msSince(uploadStart);
+            gif.stats.textureBytes += CCGIFAnimatedSprite::textureBytes(texture);
+            result = texture ? gifcore::UploadResult::Uploaded : gifcore::UploadResult::Failed;
+        }
+        //cpu copy is done either way
+        std::vector<GifByteType>().swap(gif.decoded->pixels[pending.index]);
+
+        if (--gif.remaining == 0 and gif.onUploaded) gif.onUploaded(gif);
+        return result;
+    }
+
+    virtual void update(float dt) override {
+        m_queue.drain([this](PendingFrame& pending) { return upload(pending); });
+        if (m_queue.empty()) {
+            m_scheduled = false;
+            CCDirector::get()->getScheduler()->unscheduleUpdateForTarget(this);
+        }
+    }
+
+    void require(CCGIFAnimatedSprite::GIFFrame* frame) {
+        m_queue.flush(
+            [frame](PendingFrame const& pending) { return pending.frame.data() == frame; },
+            [this](PendingFrame& pending) { return upload(pending); }
+        );
+    }
+
+    //frames of entries releaseUnusedFrames() just evicted, a restore pushes them again.
+    //taken out on purpose, so not counted as dropped. the gif still finishes once its last frame is gone
+    void discard(std::unordered_set<CCGIFAnimatedSprite::GIFFrame*> const& frames) {
+        m_queue.flush(
+            [&frames](PendingFrame const& pending) { return frames.count(pending.frame.data()) > 0; },
+            [](PendingFrame& pending) {
+                auto& gif = *pending.gif;
+                std::vector<GifByteType>().swap(gif.decoded->pixels[pending.index]);
+                if (--gif.remaining == 0 and gif.onUploaded) gif.onUploaded(gif);
+                return gifcore::UploadResult::Skipped;
+            }
+        );
+    }
+};
+
+//background loads, preload() batches and createAsync() sprites, decoded on a gifcore::TaskScheduler.
+//textures are still made back on the main thread since the gl context lives there
+class CCGIFPreloader {
+public:
+    //progress of one preload() call, only touched on the main thread
+    struct Batch {
+        size_t total = 0;
+        size_t done = 0;
+        CCGIFPreloadCallback callback;
+    };
+
+    struct Job {
+        std::string filename;
+        std::string fullPath;
+        CCGIFLoadOptions options;
+        std::shared_ptr<gifcore::JobControl> control;
+        //main thread, once the gif is in the cache (null if it failed). skipped when cancelled
+        std::function<void(CCGIFCacheManager::Entry const& data, const std::string& checksum, CCGIFLoadStats const& stats)> onCached;
+        //main thread, once every frame is on the gpu (right away when there was nothing to upload)
+        std::function<void()> onLoaded;
+    };
+
+    //one job on its way through the workers
+    struct Load {
+        Job job;
+        std::shared_ptr<gifcore::DecodedGIF> decoded = std::make_shared<gifcore::DecodedGIF>();
+        std::string checksum;
+        std::shared_ptr<const std::vector<unsigned char>> source; //file bytes, go into the cache entry
+        bool success = false;
+        CCGIFLoadStats stats;
+        CCGIFLoadTelemetry::Clock::time_point start;
+        std::shared_ptr<CCGIFCacheManager::InFlight> flight;
+        std::atomic<size_t> framesLeft = 0;
+    };
+
+    inline static CCGIFPreloader* s_sharedInstance = nullptr;
+    std::unique_ptr<gifcore::TaskScheduler> m_scheduler;
+
+    static CCGIFPreloader* get() {
+        s_sharedInstance = s_sharedInstance ? s_sharedInstance : new CCGIFPreloader();
+        return s_sharedInstance;
+    }
+
+    gifcore::TaskScheduler& scheduler() {
+        //one core stays with the main thread
+        if (!m_scheduler) m_scheduler = std::make_unique<gifcore::TaskScheduler>(std::max(2u, std::thread::hardware_concurrency()) - 1);
+        return *m_scheduler;
+    }
+
+    void enqueue(std::vector<std::string> const& paths, int priority, CCGIFPreloadCallback callback) {
+        auto batch = std::make_shared<Batch>();
+        batch->total = paths.size();
+        batch->callback = std::move(callback);
+
+        if (paths.empty()) {
+            if (batch->callback) batch->callback(0, 0);
+            return;
+        }
+
+        for (auto& path : paths) {
+            Job job;
+            job.filename = string::pathToString(path);
+            //resolve on main thread, file utils path cache isnt thread safe
+            job.fullPath = CCFileUtils::get()->fullPathForFilename(path.c_str(), false);
+            job.options = CCGIFAnimatedSprite::s_defaultLoadOptions;
+            job.control = std::make_shared<gifcore::JobControl>();
+            job.control->priority = CCGIFAnimatedSprite::loadPriority(CCGIFAnimatedSprite::kPreloadBand, priority);
+            job.onLoaded = [batch] {
+                batch->done++;
+                if (batch->callback) batch->callback(batch->done, batch->total);
+            };
+            submit(std::move(job));
+        }
+    }
+
+    //main thread: the file is read here, CCFileUtils isnt thread safe (apk reads on android all go
+    //through one unlocked ZipFile). hash, decode and composite run on the workers
+    void submit(Job job) {
+        auto load = std::make_shared<Load>();
+        load->job = std::move(job);
+
+        auto readStart = CCGIFLoadTelemetry::Clock::now();
+        unsigned long fileSize = 0;
+        unsigned char* fileData = CCFileUtils::get()->getFileData(load->job.fullPath.c_str(), "rb", &fileSize);
+        if (fileData and fileSize > 0) load->source = CCGIFAnimatedSprite::copySource(fileData, fileSize);
+        CC_SAFE_FREE(fileData);
+        load->stats.readMs = CCGIFLoadTelemetry::msSince(readStart);
+        load->stats.fileBytes = fileSize;
+
+        scheduler().submit([this, load] { run(load); }, load->job.control);
+    }
+
+    //worker: hash, then decode unless its cached or already decoding somewhere
+    void run(std::shared_ptr<Load> const& load) {
+        auto& job = load->job;
+        auto& stats = load->stats;
+        load->start = CCGIFLoadTelemetry::Clock::now();
+
+        if (!load->source) {
+            log::error("Failed to read GIF file for background load: {}", job.filename);
+            return complete(load);
+        }
+        const unsigned char* fileData = load->source->data();
+        size_t fileSize = load->source->size();
+
+        auto hashStart = CCGIFLoadTelemetry::Clock::now();
+        load->checksum = CCGIFCacheManager::calculateChecksum(fileData, fileSize);
+        stats.hashMs = CCGIFLoadTelemetry::msSince(hashStart);
+
+        auto cache = CCGIFCacheManager::get();
+        auto key = CCGIFCacheManager::makeKey(job.filename, CCGIFAnimatedSprite::cacheChecksum(load->checksum, job.options));
+        //stays set unless this load decodes it itself, same as a sync create that waited on someone elses decode
+        stats.fromCache = true;
+        while (!job.control->cancelled and !cache->isCached(key)) {
+            if (cache->beginLoad(key, load->flight)) {
+                stats.fromCache = false;
+                gifcore::Decoder decoder;
+                forwardDecoderLog(decoder);
+                decoder.m_requestIndexed = job.options.pixelFormat == CCGIFPixelFormat::Indexed;
+                decoder.m_cancel = &job.control->cancelled;
+                load->success = decoder.decodeAll(fileData, fileSize, job.filename, *load->decoded);
+                stats.decodeMs = decoder.m_timings.lzw * 1000.f;
+                stats.compositeMs = (decoder.m_timings.composite + decoder.m_timings.disposal) * 1000.f;
+                stats.duplicateFrames = load->decoded->duplicateFrames;
+                break;
+            }
+            //somebody else is on it, take theirs. if they failed or were cancelled go around and try ourselves
+            if (auto theirs = cache->waitFor(load->flight)) {
+                load->decoded = theirs;
+                load->success = true;
+                load->flight = nullptr;
+                break;
+            }
+            load->flight = nullptr;
+        }
+
+        if (load->success and load->flight) {
+            int width, height;
+            gifcore::Resampler::targetSize(load->decoded->canvasWidth, load->decoded->canvasHeight,
+                job.options.maxTextureSize, job.options.maxScale, width, height);
+            if (width != load->decoded->canvasWidth or height != load->decoded->canvasHeight) return split(load, width, height);
+        }
+        complete(load);
+    }
+
+    //the decode itself cant be split, every frame is drawn over the one before. shrinking the snapshots for
+    //upload can: one task per frame, idle workers steal them, the last one to finish completes the load
+    void split(std::shared_ptr<Load> const& load, int width, int height) {
+        size_t count = load->decoded->pixels.size();
+        load->framesLeft = count;
+        for (size_t i = 0; i < count; i++) {
+            scheduler().spawn([this, load, i, width, height] {
+                if (!load->job.control->cancelled) shrinkFrame(*load->decoded, i, width, height);
+                if (--load->framesLeft > 0) return;
+                load->decoded->pixelWidth = width;
+                load->decoded->pixelHeight = height;
+                complete(load);
+            });
+        }
+    }
+
+    static void shrinkFrame(gifcore::DecodedGIF& decoded, size_t index, int width, int height) {
+        auto& pixels = decoded.pixels[index];
+        int bytesPerPixel = decoded.indexed ? 1 : 4;
+        std::vector<GifByteType> scaled((size_t)width * height * bytesPerPixel);
+        if (decoded.indexed) {
+            gifcore::Resampler::pointSample(pixels.data(), decoded.canvasWidth, decoded.canvasHeight, 1, scaled.data(), width, height);
+        }
+        else {
+            std::vector<GifByteType> scratch(gifcore::Resampler::scratchBytes(decoded.canvasWidth, decoded.canvasHeight, width, height));
+            gifcore::Resampler::downscaleRGBA(pixels.data(), decoded.canvasWidth, decoded.canvasHeight, scaled.data(), width, height, scratch.data());
+        }
+        pixels = std::move(scaled);
+    }
+
+    //whole decode on the calling thread, shrunk the way a preload is. null if it failed
+    static std::shared_ptr<gifcore::DecodedGIF> decodeSource(std::vector<unsigned char> const& source, const std::string& filename, CCGIFLoadOptions const& options) {
+        gifcore::Decoder decoder;
+        forwardDecoderLog(decoder);
+        decoder.m_requestIndexed = options.pixelFormat == CCGIFPixelFormat::Indexed;
+        auto decoded = std::make_shared<gifcore::DecodedGIF>();
+        if (!decoder.decodeAll(source.data(), source.size(), filename, *decoded)) return nullptr;
+
+        int width, height;
+        gifcore::Resampler::targetSize(decoded->canvasWidth, decoded->canvasHeight, options.maxTextureSize, options.maxScale, width, height);
+        if (width != decoded->canvasWidth or height != decoded->canvasHeight) {
+            for (size_t i = 0; i < decoded->pixels.size(); i++) shrinkFrame(*decoded, i, width, height);
+            decoded->pixelWidth = width;
+            decoded->pixelHeight = height;
+        }
+        return decoded;
+    }
+
+    //worker, hands the result to the main thread
+    void complete(std::shared_ptr<Load> const& load) {
+        //read plus the worker side, time spent queued on either side isnt part of the load
+        load->stats.totalMs = load->stats.readMs + CCGIFLoadTelemetry::msSince(load->start);
+        if (load->job.control->cancelled) load->success = false;
+        if (load->flight) {
+            //nothing will be cached from a failed or cancelled decode, let waiters go try themselves right away
+            if (load->success) CCGIFCacheManager::get()->finishDecode(load->flight, load->decoded, load->stats);
+            else {
+                CCGIFCacheManager::get()->endLoad(load->flight);
+                load->flight = nullptr;
+            }
+        }
+        Loader::get()->queueInMainThread([load] { finish(*load); });
+    }
+
+    static void finish(Load& load) {
+        auto& job = load.job;
+        auto cache = CCGIFCacheManager::get();
+        bool cancelled = job.control->cancelled;
+
+        //a sprite that waited on our flight may have cached it already
+        CCGIFCacheManager::Entry cached;
+        bool uploading = false;
+        if (!cancelled) {
+            cached = cache->getCachedGIF(job.filename, CCGIFAnimatedSprite::cacheChecksum(load.checksum, job.options));
+            if (!cached and load.success) {
+                cached = CCGIFAnimatedSprite::publishDecoded(job.filename, load.checksum, job.options,
+                    job.control->priority, load.decoded, load.stats, load.source, job.onLoaded);
+                uploading = cached != nullptr;
+            }
+        }
+        if (load.flight) cache->endLoad(load.flight);
+
+        if (!cancelled and job.onCached) job.onCached(cached, load.checksum, load.stats);
+        if (!uploading and job.onLoaded) job.onLoaded();
+    }
+};
+
+void CCGIFAnimatedSprite::requireTexture(GIFFrame* frame) {
+    if (CCGIFUploadQueue::s_sharedInstance) CCGIFUploadQueue::s_sharedInstance->require(frame);
+}
+
+CCGIFCacheManager::Entry CCGIFAnimatedSprite::publishDecoded(const std::string& filename, const std::string& checksum, CCGIFLoadOptions const& options,
+    int priority, std::shared_ptr<gifcore::DecodedGIF> decoded, CCGIFLoadStats stats,
+    std::shared_ptr<const std::vector<unsigned char>> source, std::function<void()> onLoaded) {
+    auto uploadStart = CCGIFLoadTelemetry::Clock::now();
+    UploadTarget target;
+    auto cacheData = createCacheData(*decoded, checksum, options, target);
+    if (!cacheData) {
+        log::error("Failed to upload preloaded GIF {}", filename);
+        return nullptr;
+    }
+    cacheData->source = std::move(source);
+    auto entry = CCGIFCacheManager::get()->cacheGIF(filename, cacheChecksum(checksum, options), cacheData);
+    stats.uploadMs = CCGIFLoadTelemetry::msSince(uploadStart);
+    stats.frameCount = cacheData->frames ? cacheData->frames->count() : 1;
+    stats.textureBytes = textureBytes(cacheData->paletteTexture) + textureBytes(cacheData->staticTexture);
+
+    //counted as loaded (callback, telemetry) once its last frame is on the gpu
+    auto pending = std::make_shared<CCGIFUploadQueue::PendingGIF>();
+    pending->stats = stats;
+    pending->onUploaded = [onLoaded = std::move(onLoaded)](CCGIFUploadQueue::PendingGIF& gif) {
+        gif.stats.totalMs += gif.stats.uploadMs;
+        CCGIFLoadTelemetry::get()->record(gif.stats);
+        if (onLoaded) onLoaded();
+    };
+    if (!cacheData->frames) {
+        pending->onUploaded(*pending);
+        return entry;
+    }
+
+    pending->decoded = decoded;
+    pending->target = target;
+    CCGIFUploadQueue::get()->push(pending, cacheData->frames, priority);
+    return entry;
+}
+
+size_t CCGIFAnimatedSprite::releaseUnusedFrames() {
+    //drawn last tick, or the one before when this runs ahead of the visits (same rule as going dormant)
+    auto tick = CCGIFPlaybackClock::get()->m_tick;
+    std::unordered_set<CCGIFCacheData*> shown;
+    std::unordered_set<CCGIFCacheData*> used;
+    for (auto sprite : s_liveSprites) {
+        auto data = sprite->m_cacheEntry.get();
+        if (!data) continue;
+        used.insert(data);
+        if (sprite->m_lastVisitTick + 1 >= tick) shown.insert(data);
+    }
+
+    //a texture only goes away with its last reference, sprites keep the frame theyre showing
+    size_t freed = 0;
+    size_t released = 0;
+    auto drop = [&](CCTexture2D*& texture) {
+        if (!texture) return;
+        if (texture->retainCount() == 1) freed += textureBytes(texture);
+        CC_SAFE_RELEASE_NULL(texture);
+        released++;
+    };
+    std::unordered_set<GIFFrame*> evictedFrames;
+    for (auto data : allCacheData()) {
+        //preloads are waiting for a sprite, gd purges on scene changes which is exactly when they get used
+        if (data->evicted or !data->source or !data->used) continue;
+        if (data->frames and !shown.count(data)) {
+            for (unsigned int i = 0; i < data->frames->count(); i++) {
+                auto frame = static_cast<GIFFrame*>(data->frames->objectAtIndex(i));
+                drop(frame->m_texture);
+                evictedFrames.insert(frame);
+            }
+            data->evicted = true;
+        }
+        //sprites keep their own reference to it, nothing to gain while any is alive
+        else if (data->staticTexture and !used.count(data)) {
+            drop(data->staticTexture);
+            data->evicted = true;
+        }
+    }
+    if (!evictedFrames.empty() and CCGIFUploadQueue::s_sharedInstance) CCGIFUploadQueue::s_sharedInstance->discard(evictedFrames);
+    CCGIFStagingPool::get()->purge();
+
+    if (released) log::debug("Released {} GIF textures, {} KB freed", released, freed / 1024);
+    return freed;
+}
+
+void CCGIFAnimatedSprite::restoreCacheData(CCGIFCacheManager::Entry const& entry, bool wait) {
+    if (!entry->evicted or !entry->source) return;
+    if (wait) {
+        uploadRestored(entry.get(), CCGIFPreloader::decodeSource(*entry->source, entry->filename, entry->options));
+        return;
+    }
+    if (entry->restoring) return;
+
+    entry->restoring = true;
+    auto control = std::make_shared<gifcore::JobControl>();
+    control->priority = loadPriority(kVisibleBand, 0);
+    //the worker only reads the copies, the entry just rides along back to the main thread
+    CCGIFPreloader::get()->scheduler().submit([entry, source = entry->source, filename = entry->filename, options = entry->options] {
+        auto decoded = CCGIFPreloader::decodeSource(*source, filename, options);
+        Loader::get()->queueInMainThread([entry, decoded] { uploadRestored(entry.get(), decoded); });
+    }, control);
+}
+
+void CCGIFAnimatedSprite::uploadRestored(CCGIFCacheData* data, std::shared_ptr<gifcore::DecodedGIF> decoded) {
+    data->restoring = false;
+    if (!data->evicted) return; //a sprite needed it sooner and restored it right away
+    if (!decoded) {
+        //same bytes wont decode any better next time. the entry leaves the cache so the next create reads
+        //the file again, and sprites whose texture died with the gl context draw empty instead of never again
+        data->source = nullptr;
+        auto removed = CCGIFCacheManager::get()->m_cache.eraseIf([data](const std::string&, const CCGIFCacheData& entry) { return &entry == data; });
+        size_t blanked = 0;
+        for (auto sprite : s_liveSprites) {
+            if (sprite->m_cacheEntry.get() != data or !sprite->m_textureLost) continue;
+            sprite->m_textureLost = false;
+            sprite->setTexture(nullptr);
+            blanked++;
+        }
+        log::error("Failed to restore released GIF {}, removed from cache, {} sprites left without a texture", data->filename, blanked);
+        return;
+    }
+    if (data->contextLost and data->paletteTexture and decoded->indexed) {
+        data->paletteTexture->initWithData(decoded->palette.colors, kCCTexture2DPixelFormat_RGBA8888, 256, 1, CCSizeMake(256, 1));
+        data->paletteTexture->setAliasTexParameters();
+    }
+    data->contextLost = false;
+
+    auto target = makeUploadTarget(
+        data->options, decoded->canvasWidth, decoded->canvasHeight,
+        decoded->indexed, decoded->isOpaque, decoded->paletteFit
+    );
+    if (!data->frames) {
+        if (decoded->pixels.size() == 1) {
+            data->staticTexture = createFrameTexture(decoded->pixels[0].data(), decoded->pixelWidth, decoded->pixelHeight, target);
+        }
+        data->evicted = data->staticTexture == nullptr;
+        return;
+    }
+    //same bytes and options as the first time, anything else is a decoder bug
+    if (decoded->pixels.size() != data->frames->count()) {
+        log::error("Released GIF {} came back with {} frames instead of {}", data->filename, decoded->pixels.size(), data->frames->count());
+        return;
+    }
+
+    auto pending = std::make_shared<CCGIFUploadQueue::PendingGIF>();
+    pending->decoded = decoded;
+    pending->target = target;
+    CCGIFUploadQueue::get()->push(pending, data->frames, loadPriority(kVisibleBand, 0));
+    data->evicted = false;
+}
+
+std::unordered_set<CCGIFCacheData*> CCGIFAnimatedSprite::allCacheData() {
+    std::unordered_set<CCGIFCacheData*> entries;
+    //sprites can hold entries the cache already let go of
+    for (auto sprite : s_liveSprites) {
+        if (sprite->m_cacheEntry) entries.insert(sprite->m_cacheEntry.get());
+    }
+    CCGIFCacheManager::get()->m_cache.forEach([&](const std::string&, CCGIFCacheData& data) { entries.insert(&data); });
+    return entries;
+}
+
+void CCGIFAnimatedSprite::forgetTextures() {
+    for (auto data : allCacheData()) {
+        CCGIFTextureAccess::forgetName(data->paletteTexture);
+        CCGIFTextureAccess::forgetName(data->staticTexture);
+        if (!data->frames) continue;
+        for (unsigned int i = 0; i < data->frames->count(); i++) {
+            CCGIFTextureAccess::forgetName(static_cast<GIFFrame*>(data->frames->objectAtIndex(i))->m_texture);
+        }
+    }
+    //frames released under memory pressure can still be on screen
+    for (auto sprite : s_liveSprites) {
+        if (sprite->m_cacheEntry) CCGIFTextureAccess::forgetName(sprite->getTexture());
+    }
+}
+
+void CCGIFAnimatedSprite::reloadTextures() {
+    reloadIndexedShader();
+
+    //everything goes the way releaseUnusedFrames() sends it, palettes are refilled in place on restore
+    size_t lost = 0;
+    for (auto data : allCacheData()) {
+        CC_SAFE_RELEASE_NULL(data->staticTexture);
+        for (unsigned int i = 0; data->frames and i < data->frames->count(); i++) {
+            CC_SAFE_RELEASE_NULL(static_cast<GIFFrame*>(data->frames->objectAtIndex(i))->m_texture);
+        }
+        data->contextLost = data->paletteTexture != nullptr;
+        data->evicted = true;
+        lost++;
+    }
+
+    //nothing waits for the decodes here, sprites skip drawing until refreshTexture() finds their frame back.
+    //whats on screen now goes to the workers right away ahead of preloads and off screen loads,
+    //the rest waits until its shown, a pack full of cached gifs doesnt decode all of them on resume
+    size_t visible = 0;
+    for (auto sprite : s_liveSprites) {
+        if (!sprite->m_cacheEntry) continue;
+        sprite->m_textureLost = true;
+        auto& entry = sprite->m_cacheEntry;
+        if (!entry->source or entry->restoring or !sprite->isRunning() or !sprite->isOnScreen()) continue;
+        restoreCacheData(entry, false);
+        visible++;
+    }
+
+    log::info("GL context lost: rebuilding {} GIFs on screen in the background, {} more once theyre shown", visible, lost - visible);
+}
+
+CCGIFSyncGroup* CCGIFSyncGroups::join(CCGIFAnimatedSprite* sprite) {
+    if (sprite->m_syncGroup) return sprite->m_syncGroup;
+    if (!sprite->m_frames or sprite->m_frames->count() <= 1) return nullptr;
+
+    auto clock = CCGIFPlaybackClock::get();
+    auto key = CCGIFCacheManager::makeKey(sprite->m_filename, CCGIFAnimatedSprite::cacheChecksum(sprite->m_checksum, sprite->m_loadOptions));
+    auto& group = m_groups[key];
+    if (!group) {
+        //first member hands its playhead over, everyone after it joins mid animation like a clone would
+        group = new CCGIFSyncGroup();
+        group->key = key;
+        for (unsigned int i = 0; i < sprite->m_frames->count(); i++) {
+            group->delays.push_back(sprite->frameDelay(i));
+            group->duration += group->delays.back();
+        }
+        group->currentFrame = sprite->m_currentFrame < group->delays.size() ? sprite->m_currentFrame : 0;
+        group->frameStartTime = clock->m_time - sprite->m_frameTimer;
+    }
+
+    sprite->unscheduleUpdate();
+    sprite->m_syncGroup = group;
+    sprite->m_dormant = false;
+    sprite->m_lastVisitTick = clock->m_tick;
+    group->members.insert(sprite);
+    group->active.insert(sprite);
+    sprite->showFrame(group->currentFrame);
+    return group;
+}
+
+void CCGIFSyncGroups::leave(CCGIFAnimatedSprite* sprite) {
+    auto group = sprite->m_syncGroup;
+    if (!group) return;
+
+    sprite->m_syncGroup = nullptr;
+    group->members.erase(sprite);
+    group->active.erase(sprite);
+    if (group->members.empty()) {
+        m_groups.erase(group->key);
+        delete group;
+    }
+}
+
+void CCGIFSyncGroups::tick(double now, unsigned int tick) {
+    for (auto& [key, group] : m_groups) {
+        //same walk as CCGIFAnimatedSprite::syncToClock, groups always loop
+        unsigned int count = group->delays.size();
+        unsigned int frame = group->currentFrame;
+        if (group->duration > 0.0 and now - group->frameStartTime > group->duration) {
+            group->frameStartTime += std::floor((now - group->frameStartTime) / group->duration) * group->duration;
+        }
+        while (now - group->frameStartTime >= group->delays[frame]) {
+            group->frameStartTime += group->delays[frame];
+            frame = frame + 1 < count ? frame + 1 : 0;
+        }
+        if (frame == group->currentFrame) continue;
+
+        group->currentFrame = frame;
+        for (auto it = group->active.begin(); it != group->active.end();) {
+            auto sprite = *it;
+            //not drawn last tick, same rule as unsynchronized sprites leaving the tick set
+            if (sprite->m_lastVisitTick + 1 < tick) {
+                sprite->m_dormant = true;
+                it = group->active.erase(it);
+                continue;
+            }
+            if (sprite->m_isPlaying) sprite->showFrame(frame);
+            ++it;
+        }
+    }
+}
+
+void CCGIFAnimatedSprite::setSynchronized(bool synchronized) {
+    m_loadOptions.synchronized = synchronized;
+    if (synchronized == (m_syncGroup != nullptr)) return;
+
+    if (synchronized) {
+        CCGIFSyncGroups::get()->join(this);
+        return;
+    }
+
+    //own playhead continues from the shared one
+    auto clock = CCGIFPlaybackClock::get();
+    if (m_isPlaying) m_frameTimer = (float)(clock->m_time - m_syncGroup->frameStartTime);
+    CCGIFSyncGroups::get()->leave(this);
+    startPlayback();
+}
+
+CCGIFAnimatedSprite* CCGIFAnimatedSprite::createWithOptions(const char* pszFileName, CCGIFLoadOptions const& options) {
+    CCGIFAnimatedSprite* sprite = new CCGIFAnimatedSprite();
+    if (sprite and sprite->initWithGIFFile(pszFileName, options)) {
+        sprite->autorelease();
+        return sprite;
+    }
+    CC_SAFE_DELETE(sprite);
+    return nullptr;
+}
+
+CCGIFAnimatedSprite* CCGIFAnimatedSprite::createAsync(const char* pszFileName, CCGIFLoadOptions const& options, CCGIFLoadCallback callback) {
+    if (!pszFileName) {
+        log::error("GIF filename is null...");
+        return nullptr;
+    }
+    CCGIFAnimatedSprite* sprite = new CCGIFAnimatedSprite();
+    if (!sprite or !sprite->init()) {
+        CC_SAFE_DELETE(sprite);
+        return nullptr;
+    }
+    sprite->autorelease();
+    sprite->m_filename = string::pathToString(pszFileName);
+    sprite->m_loadOptions = options;
+    //no position yet, first visit() sorts it in
+    sprite->m_loadJob = std::make_shared<gifcore::JobControl>();
+    sprite->m_loadJob->priority = loadPriority(kSpriteBand, INT_MIN);
+
+    CCGIFPreloader::Job job;
+    job.filename = sprite->m_filename;
+    job.fullPath = CCFileUtils::get()->fullPathForFilename(pszFileName, false);
+    job.options = options;
+    job.control = sprite->m_loadJob;
+    //never called after the sprite is gone, its destructor cancels the job
+    job.onCached = [sprite, callback](CCGIFCacheManager::Entry const& data, const std::string& checksum, CCGIFLoadStats const& stats) {
+        sprite->m_checksum = checksum;
+        sprite->m_loadStats = stats;
+        bool success = data and sprite->initWithCachedData(data);
+        sprite->m_loadJob = nullptr;
+        if (!success) log::error("Failed to load GIF {} in background", sprite->m_filename);
+        if (callback) callback(sprite, success);
+    };
+    CCGIFPreloader::get()->submit(std::move(job));
+    return sprite;
+}
+
+CCGIFInfo CCGIFAnimatedSprite::probe(const char* pszFileName) {
+    CCGIFInfo info;
+    if (!pszFileName) {
+        log::error("GIF filename is null...");
+        return info;
+    }
+
+    unsigned long fileSize = 0;
+    unsigned char* fileData = CCFileUtils::get()->getFileData(pszFileName, "rb", &fileSize);
+    if (!fileData or fileSize == 0) {
+        log::error("Failed to read GIF file: {}", pszFileName);
+        if (fileData) CC_SAFE_FREE(fileData);
+        return info;
+    }
+
+    gifcore::Decoder decoder;
+    forwardDecoderLog(decoder);
+    gifcore::GIFInfo probed;
+    info.valid = decoder.probe(fileData, fileSize, pszFileName, probed);
+    CC_SAFE_FREE(fileData);
+
+    info.width = probed.width;
+    info.height = probed.height;
+    info.frameCount = probed.frameCount;
+    info.duration = probed.duration;
+    info.loopCount = probed.loopCount;
+    return info;
+}
+
+void CCGIFAnimatedSprite::setDefaultLoadOptions(CCGIFLoadOptions const& options) {
+    s_defaultLoadOptions = options;
+}
+
+CCGIFLoadOptions CCGIFAnimatedSprite::getDefaultLoadOptions() {
+    return s_defaultLoadOptions;
+}
+
+CCGIFLoadHistogram CCGIFAnimatedSprite::getLoadHistogram() {
+    return CCGIFLoadTelemetry::get()->getHistogram();
+}
+
+void CCGIFAnimatedSprite::resetLoadHistogram() {
+    CCGIFLoadTelemetry::get()->reset();
+}
+
+CCGIFMemoryReport CCGIFAnimatedSprite::getMemoryReport() {
+    CCGIFMemoryReport report;
+    std::map<std::string, CCGIFMemoryEntry> entries;
+    std::unordered_set<CCTexture2D*> counted; //cache and sprites share textures
+
+    auto addTexture = [&](CCGIFMemoryEntry& entry, CCTexture2D* texture) {
+        if (texture and counted.insert(texture).second) entry.textureBytes += textureBytes(texture);
+    };
+    auto addFrames = [&](CCGIFMemoryEntry& entry, CCArray* frames, CCTexture2D* palette, CCTexture2D* staticTexture) {
+        addTexture(entry, palette);
+        if (staticTexture) {
+            addTexture(entry, staticTexture);
+            entry.frameCount = std::max(entry.frameCount, 1u);
+        }
+        if (!frames) return;
+        entry.frameCount = std::max(entry.frameCount, frames->count());
+        for (unsigned int i = 0; i < frames->count(); i++) {
+            if (auto frame = typeinfo_cast<GIFFrame*>(frames->objectAtIndex(i))) addTexture(entry, frame->m_texture);
+        }
+    };
+
+    CCGIFCacheManager::get()->m_cache.forEach([&](const std::string& key, CCGIFCacheData& data) {
+        auto& entry = entries[key];
+        entry.filename = data.filename;
+        entry.checksum = key.substr(data.filename.size() + 1);
+        entry.cached = true;
+        entry.cpuBytes += sizeof(CCGIFCacheData) + framesCpuBytes(data.frames) + (data.source ? data.source->size() : 0);
+        addFrames(entry, data.frames, data.paletteTexture, data.staticTexture);
+    });
+
+    for (auto sprite : s_liveSprites) {
+        if (!sprite->m_frames and !sprite->m_staticTexture) continue; //never finished loading
+        auto checksum = cacheChecksum(sprite->m_checksum, sprite->m_loadOptions);
+        auto& entry = entries[CCGIFCacheManager::makeKey(sprite->m_filename, checksum)];
+        entry.filename = sprite->m_filename;
+        entry.checksum = checksum;
+        entry.liveSprites++;
+        entry.cpuBytes += sizeof(CCGIFAnimatedSprite) + framesCpuBytes(sprite->m_frames);
+        addFrames(entry, sprite->m_frames, sprite->m_paletteTexture, sprite->m_staticTexture);
+    }
+
+    for (auto& [key, entry] : entries) {
+        report.textureBytes += entry.textureBytes;
+        report.cpuBytes += entry.cpuBytes;
+        report.liveSprites += entry.liveSprites;
+        if (entry.cached) report.cacheEntries++;
+        report.entries.push_back(std::move(entry));
+    }
+    std::sort(report.entries.begin(), report.entries.end(), [](auto const& a, auto const& b) {
+        return a.textureBytes > b.textureBytes;
+    });
+
+    report.stagingBytes = CCGIFStagingPool::get()->getStats().bytesHeld;
+    report.cpuBytes += report.stagingBytes;
+    return report;
+}
+
+void CCGIFAnimatedSprite::logMemoryReport() {
+    auto report = getMemoryReport();
+    log::debug(
+        "GIF memory: {} KB textures, {} KB cpu ({} KB staging), {} live sprites, {} cache entries",
+        report.textureBytes / 1024, report.cpuBytes / 1024, report.stagingBytes / 1024, report.liveSprites, report.cacheEntries
+    );
+    for (auto& entry : report.entries) {
+        log::debug(
+            "  - {} [{}]: {} KB textures, {} KB cpu, {} frames, {} sprites{}",
+            entry.filename, entry.checksum, entry.textureBytes / 1024, entry.cpuBytes / 1024,
+            entry.frameCount, entry.liveSprites, entry.cached ? ", cached" : ""
+        );
+    }
+}
+
+void CCGIFAnimatedSprite::preload(std::vector<std::string> const& paths, int priority, CCGIFPreloadCallback callback) {
+    CCGIFCacheManager::get(); //make sure singleton exists before workers run
+    CCGIFPreloader::get()->enqueue(paths, priority, std::move(callback));
+}
+
+void CCGIFAnimatedSprite::setUploadBudget(float milliseconds, size_t bytes) {
+    auto& budget = CCGIFUploadQueue::get()->m_queue.m_budget;
+    budget.seconds = milliseconds / 1000.0;
+    budget.bytes = bytes;
+}
+
+CCGIFUploadStats CCGIFAnimatedSprite::getUploadStats() {
+    auto& queued = CCGIFUploadQueue::get()->m_queue.m_stats;
+    CCGIFUploadStats stats;
+    stats.uploaded = queued.uploaded;
+    stats.failed = queued.failed;
+    stats.dropped = queued.dropped;
+    stats.bytes = queued.bytes;
+    stats.pending = queued.pending;
+    stats.ticks = queued.drains;
+    stats.deferredTicks = queued.deferredDrains;
+    stats.totalMs = (float)(queued.seconds * 1000.0);
+    stats.maxTickMs = (float)(queued.maxDrainSeconds * 1000.0);
+    return stats;
+}
 
 NS_CC_END;
 
@@ -778,12 +2312,44 @@ public:
 
     static CCSprite* create(const char* pszFileName) {
         //header check allows users to hack around extension in filenames
+        auto sniffStart = CCGIFLoadTelemetry::Clock::now();
         if (isGifHeader(pszFileName)) {
+            float sniffMs = CCGIFLoadTelemetry::msSince(sniffStart);
+            CCGIFLoadTelemetry::get()->addSample(CCGIFLoadStage::Sniff, sniffMs);
             if (auto gifSprite = CCGIFAnimatedSprite::create(pszFileName)) {
+                gifSprite->m_loadStats.sniffMs = sniffMs;
                 return gifSprite;
             }
             else log::error("Failed to create GIF sprite from {}", pszFileName);
         }
         return CCSprite::create(pszFileName);
     }
-};
\ No newline at end of file
+};
+
+//cocos purge paths (low memory warnings end up in purgeCachedData too) never reach gif frames,
+//they arent in the texture cache. both run it, the second pass finds everything released already
+#include <Geode/modify/CCTextureCache.hpp>
+class $modify(CCTextureCacheGifExt, CCTextureCache) {
+public:
+    void removeUnusedTextures() {
+        CCGIFAnimatedSprite::releaseUnusedFrames();
+        CCTextureCache::removeUnusedTextures();
+    }
+
+    //android gl context came back empty. cocos rebuilds its own textures from their files,
+    //gif frames were made from canvases that are long gone
+    static void reloadAllTextures() {
+        CCGIFAnimatedSprite::forgetTextures();
+        CCTextureCache::reloadAllTextures();
+        CCGIFAnimatedSprite::reloadTextures();
+    }
+};
+
+#include <Geode/modify/CCDirector.hpp>
+class $modify(CCDirectorGifExt, CCDirector) {
+public:
+    void purgeCachedData() {
+        CCGIFAnimatedSprite::releaseUnusedFrames();
+        CCDirector::purgeCachedData();
+    }
+};
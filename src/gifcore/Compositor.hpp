@@ -0,0 +1,130 @@
+#pragma once
+
+#include <gif_lib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace gifcore {
+
+//frame raster -> canvas copy, specialized per frame instead of testing every pixel.
+//transparency and out of range indices both become a keep mask in the lookup tables,
+//so every variant is a plain table load + store, the only thing left to pick is the loop shape
+struct Compositor {
+    //decided once per frame by select(), resolve() turns it into the matching instantiation
+    struct Traits {
+        bool indexed = false; //1 byte palette slots instead of packed rgba
+        bool keyed = false; //some index keeps the canvas pixel (transparent color or past ColorCount)
+    };
+
+    //per frame lookup, 256 entries so any byte the lzw decoder produced is a valid index
+    struct Tables {
+        uint32_t rgba[256] = {}; //packed in canvas byte order
+        uint32_t rgbaKeep[256] = {}; //~0 where the canvas pixel stays, value is 0 there
+        GifByteType index[256] = {};
+        GifByteType indexKeep[256] = {};
+        bool keyed = false;
+
+        //keep = false writes transparent black for transparent/out of range, for frames that cover an empty canvas
+        void buildRGBA(const ColorMapObject* colorMap, int transparentColorIndex, bool keep) {
+            int colorCount = colorMap->ColorCount < 256 ? colorMap->ColorCount : 256;
+            keyed = false;
+            for (int i = 0; i < 256; i++) {
+                if (i >= colorCount or i == transparentColorIndex) {
+                    rgba[i] = 0;
+                    rgbaKeep[i] = keep ? ~0u : 0u;
+                    keyed = keyed or keep;
+                    continue;
+                }
+                GifByteType c[4] = { colorMap->Colors[i].Red, colorMap->Colors[i].Green, colorMap->Colors[i].Blue, 255 };
+                memcpy(&rgba[i], c, 4);
+                rgbaKeep[i] = 0;
+            }
+        }
+
+        //translation comes from Palette::translation, which already maps out of range to the transparent slot
+        void buildIndexed(const GifByteType translation[256], int colorCount, int transparentColorIndex, GifByteType transparentSlot, bool keep) {
+            keyed = false;
+            for (int i = 0; i < 256; i++) {
+                if (i >= colorCount or i == transparentColorIndex) {
+                    index[i] = keep ? 0 : transparentSlot;
+                    indexKeep[i] = keep ? 0xff : 0;
+                    keyed = keyed or keep;
+                    continue;
+                }
+                index[i] = translation[i];
+                indexKeep[i] = 0;
+            }
+        }
+    };
+
+    //clipped frame rect on the canvas, raster row y lands on canvas row top + y
+    struct Job {
+        const GifByteType* raster = nullptr;
+        int rasterStride = 0;
+        GifByteType* canvas = nullptr;
+        int canvasWidth = 0;
+        int left = 0;
+        int top = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    using Fn = bool (*)(Job const&, Tables const&);
+
+    static Traits select(Tables const& tables, bool indexed) {
+        Traits traits;
+        traits.indexed = indexed;
+        traits.keyed = tables.keyed;
+        return traits;
+    }
+
+    static const char* name(Traits const& traits) {
+        static const char* names[4] = { "rgba", "rgba keyed", "indexed", "indexed keyed" };
+        return names[(traits.indexed ? 2 : 0) + (traits.keyed ? 1 : 0)];
+    }
+
+    //true if any canvas pixel changed.
+    //no whole frame single run variant: the decoder composites one lzw row at a time, a run is never longer than a row
+    template <typename Pixel, bool Keyed>
+    static bool composite(Job const& job, Tables const& tables) {
+        const Pixel* value;
+        const Pixel* keep;
+        if constexpr (sizeof(Pixel) == 1) {
+            value = tables.index;
+            keep = tables.indexKeep;
+        }
+        else {
+            value = tables.rgba;
+            keep = tables.rgbaKeep;
+        }
+
+        uint32_t changed = 0;
+        for (int y = 0; y < job.height; y++) {
+            const GifByteType* src = job.raster + (size_t)y * job.rasterStride;
+            GifByteType* dst = job.canvas + ((size_t)(job.top + y) * job.canvasWidth + job.left) * sizeof(Pixel);
+            for (int x = 0; x < job.width; x++) {
+                GifByteType colorIndex = src[x];
+                Pixel old;
+                memcpy(&old, dst + (size_t)x * sizeof(Pixel), sizeof(Pixel));
+                Pixel out = Keyed ? (Pixel)((old & keep[colorIndex]) | value[colorIndex]) : value[colorIndex];
+                //or-ing the differences keeps the loop branch free, checked once after the frame
+                changed |= old ^ out;
+                memcpy(dst + (size_t)x * sizeof(Pixel), &out, sizeof(Pixel));
+            }
+        }
+        return changed != 0;
+    }
+
+    //looked up once per frame, callers keep the pointer and call it per row
+    static Fn resolve(Traits const& traits) {
+        static const Fn fns[4] = {
+            composite<uint32_t, false>, composite<uint32_t, true>,
+            composite<GifByteType, false>, composite<GifByteType, true>,
+        };
+        return fns[(traits.indexed ? 2 : 0) + (traits.keyed ? 1 : 0)];
+    }
+};
+
+}
@@ -0,0 +1,725 @@
+#include <gifcore/Decoder.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace gifcore {
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//giflib leaves Error at 0 for some failures (bad image size), GifErrorString gives null then
+static const char* errorString(int error) {
+    const char* message = GifErrorString(error);
+    return message ? message : "malformed GIF data";
+}
+
+void Decoder::report(LogLevel level, const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (level == LogLevel::Error) m_error = buf;
+    else if (level == LogLevel::Warn) m_warnings.emplace_back(buf);
+    if (m_log) m_log(level, buf);
+}
+
+Decoder::~Decoder() {
+    if (m_canvasBuffer) {
+        free(m_canvasBuffer);
+        m_canvasBuffer = nullptr;
+    }
+    if (m_previousBuffer) {
+        free(m_previousBuffer);
+        m_previousBuffer = nullptr;
+    }
+    if (m_globalColorMap) {
+        GifFreeMapObject(m_globalColorMap);
+        m_globalColorMap = nullptr;
+    }
+}
+
+struct GifMemoryData {
+    const unsigned char* data;
+    unsigned long size;
+    unsigned long position;
+};
+
+static int inputFunc(GifFileType* gif, GifByteType* buf, int count) {
+    GifMemoryData* memData = static_cast<GifMemoryData*>(gif->UserData);
+    if (!memData or !buf) return 0;
+
+    int bytesToRead = count;
+    if (memData->position + bytesToRead > memData->size) {
+        bytesToRead = memData->size - memData->position;
+    }
+
+    if (bytesToRead <= 0) return 0;
+
+    memcpy(buf, memData->data + memData->position, bytesToRead);
+    memData->position += bytesToRead;
+    return bytesToRead;
+}
+
+bool Decoder::decode(const unsigned char* fileData, unsigned long fileSize, const std::string& name, FrameCallback const& onFrame) {
+    GifMemoryData memData = { fileData, fileSize, 0 };
+    int error = 0;
+    GifFileType* gifFile = DGifOpen(&memData, inputFunc, &error);
+    if (!gifFile) {
+        report(LogLevel::Error, "Failed to open GIF file at %s: %s", name.c_str(), errorString(error));
+        return false;
+    }
+
+    //screen size is known after the header, dont scan frames we would reject anyway
+    if (!checkCanvasSize(gifFile->SWidth, gifFile->SHeight)) {
+        DGifCloseFile(gifFile);
+        return false;
+    }
+
+    //frame layout, palettes and control blocks first, the lzw data is only skipped here
+    auto scanStart = Clock::now();
+    bool scanned = scanStructure(gifFile);
+    m_timings.lzw += secondsSince(scanStart);
+    if (!scanned) {
+        report(LogLevel::Error, "Failed to read GIF data from %s: %s", name.c_str(), errorString(gifFile->Error));
+        DGifCloseFile(gifFile);
+        return false;
+    }
+
+    //second reader over the same bytes, pixels are decoded from it row by row straight into the canvas
+    GifMemoryData streamData = { fileData, fileSize, 0 };
+    GifFileType* stream = DGifOpen(&streamData, inputFunc, &error);
+    if (!stream) {
+        report(LogLevel::Error, "Failed to open GIF file at %s: %s", name.c_str(), errorString(error));
+        DGifCloseFile(gifFile);
+        return false;
+    }
+
+    bool success = processGIFData(gifFile, stream, onFrame);
+
+    DGifCloseFile(stream);
+    DGifCloseFile(gifFile);
+    return success;
+}
+
+bool Decoder::decodeAll(const unsigned char* fileData, unsigned long fileSize, const std::string& name, DecodedGIF& out) {
+    bool success = decode(fileData, fileSize, name, [&](const FrameInfo& info, const GifByteType* canvas) {
+        //same picture as before, just show the previous snapshot longer
+        if (info.duplicate and !out.frames.empty()) {
+            out.frames.back().delay += info.delay;
+            out.duplicateFrames++;
+            return true;
+        }
+        out.frames.push_back(info);
+        out.pixels.emplace_back(canvas, canvas + (size_t)m_canvasWidth * m_canvasHeight * m_bytesPerPixel);
+        return true;
+    });
+    out.canvasWidth = out.pixelWidth = m_canvasWidth;
+    out.canvasHeight = out.pixelHeight = m_canvasHeight;
+    out.hasTransparentBackground = m_hasTransparentBackground;
+    out.isOpaque = m_isOpaque;
+    out.paletteFit = m_paletteFit;
+    out.imageCount = m_imageCount;
+    out.indexed = m_indexed;
+    out.palette = m_palette;
+    return success and !out.frames.empty();
+}
+
+bool Decoder::probe(const unsigned char* fileData, unsigned long fileSize, const std::string& name, GIFInfo& out) {
+    out = GIFInfo();
+    GifMemoryData memData = { fileData, fileSize, 0 };
+    int error = 0;
+    GifFileType* gifFile = DGifOpen(&memData, inputFunc, &error);
+    if (!gifFile) {
+        report(LogLevel::Error, "Failed to open GIF file at %s: %s", name.c_str(), errorString(error));
+        return false;
+    }
+    out.width = gifFile->SWidth;
+    out.height = gifFile->SHeight;
+
+    bool success = probeBlocks(gifFile, out);
+    if (!success) report(LogLevel::Error, "Failed to read GIF data from %s: %s", name.c_str(), errorString(gifFile->Error));
+    else if (out.frameCount == 0) {
+        report(LogLevel::Error, "No images in GIF %s", name.c_str());
+        success = false;
+    }
+    DGifCloseFile(gifFile);
+    return success;
+}
+
+bool Decoder::probeBlocks(GifFileType* gifFile, GIFInfo& out) {
+    //a control block applies to the next image, like readFrameInfo picking it from that images extensions
+    float delay = 0.1f;
+    GifRecordType recordType;
+
+    do {
+        if (DGifGetRecordType(gifFile, &recordType) == GIF_ERROR) return false;
+
+        if (recordType == IMAGE_DESC_RECORD_TYPE) {
+            if (DGifGetImageDesc(gifFile) == GIF_ERROR) return false;
+
+            int codeSize;
+            GifByteType* codeBlock;
+            if (DGifGetCode(gifFile, &codeSize, &codeBlock) == GIF_ERROR) return false;
+            while (codeBlock) {
+                if (DGifGetCodeNext(gifFile, &codeBlock) == GIF_ERROR) return false;
+            }
+
+            out.frameCount++;
+            out.duration += delay;
+            delay = 0.1f;
+        }
+        else if (recordType == EXTENSION_RECORD_TYPE) {
+            int function;
+            GifByteType* data;
+            if (DGifGetExtension(gifFile, &function, &data) == GIF_ERROR) return false;
+
+            GraphicsControlBlock gcb;
+            if (function == GRAPHICS_EXT_FUNC_CODE and data and DGifExtensionToGCB(data[0], &data[1], &gcb) == GIF_OK) {
+                delay = gcb.DelayTime > 0 ? gcb.DelayTime / 100.0f : 0.1f;
+            }
+            bool loopBlock = function == APPLICATION_EXT_FUNC_CODE and data and data[0] == 11
+                and (memcmp(&data[1], "NETSCAPE2.0", 11) == 0 or memcmp(&data[1], "ANIMEXTS1.0", 11) == 0);
+
+            while (data) {
+                if (DGifGetExtensionNext(gifFile, &data) == GIF_ERROR) return false;
+                //sub-block id 1, then the count little endian
+                if (loopBlock and data and data[0] >= 3 and data[1] == 1) {
+                    out.loopCount = data[2] | data[3] << 8;
+                    loopBlock = false;
+                }
+            }
+        }
+    } while (recordType != TERMINATE_RECORD_TYPE);
+
+    return true;
+}
+
+bool Decoder::checkCanvasSize(GifWord width, GifWord height) {
+    if (width <= 0 or height <= 0) {
+        report(LogLevel::Error, "Invalid GIF canvas dimensions: %dx%d", width, height);
+        return false;
+    }
+    if ((size_t)width * height > m_maxCanvasPixels) {
+        report(LogLevel::Error, "GIF canvas %dx%d is over the %zu pixel limit", width, height, m_maxCanvasPixels);
+        return false;
+    }
+    return true;
+}
+
+//same walk as DGifSlurp minus the lzw decode: image descriptors, local color maps and
+//extension blocks end up in SavedImages like after a slurp, RasterBits stay null
+bool Decoder::scanStructure(GifFileType* gifFile) {
+    GifRecordType recordType;
+    gifFile->ExtensionBlocks = nullptr;
+    gifFile->ExtensionBlockCount = 0;
+
+    do {
+        if (DGifGetRecordType(gifFile, &recordType) == GIF_ERROR) return false;
+
+        if (recordType == IMAGE_DESC_RECORD_TYPE) {
+            if (DGifGetImageDesc(gifFile) == GIF_ERROR) return false;
+
+            SavedImage* savedImage = &gifFile->SavedImages[gifFile->ImageCount - 1];
+            auto& desc = savedImage->ImageDesc;
+            if (desc.Width <= 0 or desc.Height <= 0 or desc.Width > INT_MAX / desc.Height) return false;
+
+            int codeSize;
+            GifByteType* codeBlock;
+            if (DGifGetCode(gifFile, &codeSize, &codeBlock) == GIF_ERROR) return false;
+            while (codeBlock) {
+                if (DGifGetCodeNext(gifFile, &codeBlock) == GIF_ERROR) return false;
+            }
+
+            //extensions read since the previous image belong to this one
+            if (gifFile->ExtensionBlocks) {
+                savedImage->ExtensionBlocks = gifFile->ExtensionBlocks;
+                savedImage->ExtensionBlockCount = gifFile->ExtensionBlockCount;
+                gifFile->ExtensionBlocks = nullptr;
+                gifFile->ExtensionBlockCount = 0;
+            }
+        }
+        else if (recordType == EXTENSION_RECORD_TYPE) {
+            int function;
+            GifByteType* data;
+            if (DGifGetExtension(gifFile, &function, &data) == GIF_ERROR) return false;
+            if (data and GifAddExtensionBlock(&gifFile->ExtensionBlockCount, &gifFile->ExtensionBlocks, function, data[0], &data[1]) == GIF_ERROR) {
+                return false;
+            }
+            while (data) {
+                if (DGifGetExtensionNext(gifFile, &data) == GIF_ERROR) return false;
+                if (data and GifAddExtensionBlock(&gifFile->ExtensionBlockCount, &gifFile->ExtensionBlocks, CONTINUE_EXT_FUNC_CODE, data[0], &data[1]) == GIF_ERROR) {
+                    return false;
+                }
+            }
+        }
+    } while (recordType != TERMINATE_RECORD_TYPE);
+
+    return true;
+}
+
+bool Decoder::nextImage(GifFileType* stream) {
+    GifRecordType recordType;
+    do {
+        if (DGifGetRecordType(stream, &recordType) == GIF_ERROR) return false;
+        if (recordType == TERMINATE_RECORD_TYPE) return false;
+        if (recordType == EXTENSION_RECORD_TYPE) {
+            //already collected by the scan
+            int function;
+            GifByteType* data;
+            if (DGifGetExtension(stream, &function, &data) == GIF_ERROR) return false;
+            while (data) {
+                if (DGifGetExtensionNext(stream, &data) == GIF_ERROR) return false;
+            }
+        }
+    } while (recordType != IMAGE_DESC_RECORD_TYPE);
+
+    return DGifGetImageDesc(stream) != GIF_ERROR;
+}
+
+bool Decoder::processGIFData(GifFileType* gifFile, GifFileType* stream, FrameCallback const& onFrame) {
+    if (!gifFile or gifFile->ImageCount <= 0) {
+        report(LogLevel::Error, "Invalid GIF file or no images");
+        return false;
+    }
+
+    m_canvasWidth = gifFile->SWidth;
+    m_canvasHeight = gifFile->SHeight;
+
+    if (!checkCanvasSize(m_canvasWidth, m_canvasHeight)) return false;
+
+    //check if any fucking frame has transparencyyyyyaa
+    m_hasTransparentBackground = false;
+    for (int i = 0; i < gifFile->ImageCount; i++) {
+        GraphicsControlBlock gcb;
+        if (DGifSavedExtensionToGCB(gifFile, i, &gcb) == GIF_OK) {
+            if (gcb.TransparentColor != NO_TRANSPARENT_COLOR) {
+                m_hasTransparentBackground = true;
+                break;
+            }
+        }
+    }
+
+    analyzeFrames(gifFile);
+
+    m_imageCount = gifFile->ImageCount;
+    m_bytesPerPixel = m_indexed ? 1 : 4;
+
+    //static gif (gif used as png), one pass straight into the buffer that gets uploaded
+    if (gifFile->ImageCount == 1) return processSingleFrame(gifFile, stream, onFrame);
+
+    //store global color map
+    if (gifFile->SColorMap) {
+        m_globalColorMap = GifMakeMapObject(gifFile->SColorMap->ColorCount, gifFile->SColorMap->Colors);
+        if (!m_globalColorMap) {
+            report(LogLevel::Error, "Failed to copy global color map");
+            return false;
+        }
+    }
+
+    //alloc canvas buff
+    size_t canvasSize = (size_t)m_canvasWidth * m_canvasHeight * m_bytesPerPixel; //rgba or index
+    m_canvasBuffer = static_cast<GifByteType*>(malloc(canvasSize));
+
+    if (!m_canvasBuffer) {
+        report(LogLevel::Error, "Failed to allocate canvas buffers");
+        return false;
+    }
+
+    initializeCanvas();
+
+    //process each frame
+    int processed = 0;
+    FrameInfo prevInfo;
+    for (int i = 0; i < gifFile->ImageCount; i++) {
+        if (checkCancel()) {
+            report(LogLevel::Debug, "Decode cancelled before frame %d", i);
+            return false;
+        }
+
+        FrameInfo info;
+        bool ready = processFrame(info, &gifFile->SavedImages[i], gifFile, i, processed > 0 ? &prevInfo : nullptr);
+        if (!ready) report(LogLevel::Warn, "Failed to process frame %d", i);
+
+        //a skipped frame still has to be decoded, slurp would have failed on broken lzw data too
+        if (!nextImage(stream) or !streamFrame(stream, ready)) {
+            if (m_cancelled) report(LogLevel::Debug, "Decode cancelled in frame %d", i);
+            else report(LogLevel::Error, "Failed to decode frame %d: %s", i, errorString(stream->Error));
+            return false;
+        }
+        if (!ready) continue;
+
+        info.duplicate = processed > 0 and !m_canvasChanged;
+        if (!onFrame(info, m_canvasBuffer)) {
+            report(LogLevel::Warn, "Frame %d was rejected by consumer", i);
+            continue;
+        }
+
+        prevInfo = info;
+        processed++;
+        m_canvasChanged = false;
+    }
+
+    if (processed == 0) {
+        report(LogLevel::Error, "No valid frames processed");
+        return false;
+    }
+
+    report(
+        LogLevel::Debug, "Successfully decoded GIF with %d frames (%dx%d)",
+        processed, m_canvasWidth, m_canvasHeight
+    );
+    return true;
+}
+
+bool Decoder::processSingleFrame(GifFileType* gifFile, GifFileType* stream, FrameCallback const& onFrame) {
+    SavedImage* savedImage = &gifFile->SavedImages[0];
+    FrameInfo info;
+    readFrameInfo(info, savedImage, gifFile, 0);
+
+    //giflib keeps the global map alive until close, no copy needed for one frame
+    ColorMapObject* colorMap = savedImage->ImageDesc.ColorMap
+        ? savedImage->ImageDesc.ColorMap
+        : gifFile->SColorMap;
+    if (!colorMap) {
+        report(LogLevel::Error, "No color map available for frame 0");
+        return false;
+    }
+
+    m_canvasBuffer = static_cast<GifByteType*>(malloc((size_t)m_canvasWidth * m_canvasHeight * m_bytesPerPixel));
+    if (!m_canvasBuffer) {
+        report(LogLevel::Error, "Failed to allocate canvas buffers");
+        return false;
+    }
+
+    //frame covers the whole canvas so every pixel gets written exactly once,
+    //transparent and out of range indices write transparent instead of keeping the cleared canvas
+    auto& desc = savedImage->ImageDesc;
+    bool covering = desc.Left == 0 and desc.Top == 0 and desc.Width >= m_canvasWidth and desc.Height >= m_canvasHeight;
+    if (!covering) initializeCanvas();
+    if (!setupFrameJob(desc, colorMap, info.transparentColorIndex, !covering)) {
+        report(LogLevel::Error, "Failed to render frame 0 to canvas");
+        return false;
+    }
+
+    if (!nextImage(stream) or !streamFrame(stream, true)) {
+        if (m_cancelled) report(LogLevel::Debug, "Decode cancelled in frame 0");
+        else report(LogLevel::Error, "Failed to decode frame 0: %s", errorString(stream->Error));
+        return false;
+    }
+
+    if (!onFrame(info, m_canvasBuffer)) {
+        report(LogLevel::Error, "Static frame was rejected by consumer");
+        return false;
+    }
+
+    report(LogLevel::Debug, "Successfully decoded static GIF (%dx%d)", m_canvasWidth, m_canvasHeight);
+    return true;
+}
+
+void Decoder::analyzeFrames(GifFileType* gifFile) {
+    m_paletteFit = PixelConverter::PaletteFit();
+    m_paletteFit.add(gifFile->SColorMap);
+    for (int i = 0; i < gifFile->ImageCount; i++) {
+        m_paletteFit.add(gifFile->SavedImages[i].ImageDesc.ColorMap);
+    }
+
+    //canvas starts transparent, so the first frame has to cover it
+    //and nothing may punch holes back into it later
+    auto& first = gifFile->SavedImages[0].ImageDesc;
+    m_isOpaque = !m_hasTransparentBackground
+        and first.Left == 0 and first.Top == 0
+        and first.Width >= m_canvasWidth and first.Height >= m_canvasHeight;
+
+    for (int i = 0; i < gifFile->ImageCount and m_isOpaque; i++) {
+        GraphicsControlBlock gcb;
+        if (DGifSavedExtensionToGCB(gifFile, i, &gcb) != GIF_OK) continue;
+        if (gcb.DisposalMode == DISPOSE_BACKGROUND) m_isOpaque = false;
+        if (gcb.DisposalMode == DISPOSE_PREVIOUS and i == 0) m_isOpaque = false;
+    }
+
+    m_indexed = false;
+    if (m_requestIndexed) {
+        m_palette = Palette();
+        bool fits = m_palette.add(gifFile->SColorMap);
+        for (int i = 0; i < gifFile->ImageCount and fits; i++) {
+            fits = m_palette.add(gifFile->SavedImages[i].ImageDesc.ColorMap);
+        }
+        if (fits) {
+            m_palette.finalize();
+            m_indexed = true;
+        }
+        else report(LogLevel::Debug, "GIF uses more than 255 colors in total, indexed mode not possible");
+    }
+}
+
+void Decoder::initializeCanvas() {
+    if (!m_canvasBuffer) return;
+
+    if (m_indexed) {
+        size_t canvasSize = (size_t)m_canvasWidth * m_canvasHeight;
+        memset(m_canvasBuffer, m_palette.transparentSlot, canvasSize);
+        return;
+    }
+
+    size_t canvasSize = (size_t)m_canvasWidth * m_canvasHeight * 4;
+
+    for (size_t i = 0; i < canvasSize; i += 4) {
+        m_canvasBuffer[i] = 0;
+        m_canvasBuffer[i + 1] = 0;
+        m_canvasBuffer[i + 2] = 0;
+        m_canvasBuffer[i + 3] = 0;
+    }
+}
+
+void Decoder::readFrameInfo(FrameInfo& info, SavedImage* savedImage, GifFileType* gifFile, int frameIndex) {
+    info.imageDesc = savedImage->ImageDesc;
+    info.imageDesc.ColorMap = nullptr; //owned by giflib, dont let it outlive the decode
+    info.delay = 0.1f; //default delay
+    info.disposalMethod = DISPOSE_DO_NOT;
+    info.transparentColorIndex = NO_TRANSPARENT_COLOR;
+
+    //parse graphics control block
+    GraphicsControlBlock gcb;
+    if (DGifSavedExtensionToGCB(gifFile, frameIndex, &gcb) == GIF_OK) {
+        info.delay = gcb.DelayTime > 0 ? gcb.DelayTime / 100.0f : 0.1f;
+        info.disposalMethod = gcb.DisposalMode;
+        info.transparentColorIndex = gcb.TransparentColor;
+    }
+}
+
+bool Decoder::processFrame(FrameInfo& info, SavedImage* savedImage, GifFileType* gifFile, int frameIndex, const FrameInfo* prevInfo) {
+    if (!savedImage) return false;
+
+    readFrameInfo(info, savedImage, gifFile, frameIndex);
+
+    //choose color map (local takes precedence over global)
+    ColorMapObject* colorMap = savedImage->ImageDesc.ColorMap
+        ? savedImage->ImageDesc.ColorMap
+        : m_globalColorMap;
+
+    if (!colorMap) {
+        report(LogLevel::Error, "No color map available for frame %d", frameIndex);
+        return false;
+    }
+
+    //apply disposal method from previous frame BEFORE rendering current frame
+    auto disposalStart = Clock::now();
+    if (prevInfo) {
+        applyDisposalMethodForFrame(*prevInfo);
+    }
+
+    //only frames that restore afterwards need what was under them
+    bool saved = info.disposalMethod != DISPOSE_PREVIOUS or saveFrameArea(info.imageDesc);
+    m_timings.disposal += secondsSince(disposalStart);
+    if (!saved) {
+        report(LogLevel::Error, "Failed to save canvas area for frame %d", frameIndex);
+        return false;
+    }
+
+    //pixels land in the canvas while streamFrame decodes them
+    if (!setupFrameJob(savedImage->ImageDesc, colorMap, info.transparentColorIndex, true)) {
+        report(LogLevel::Error, "Failed to render frame %d to canvas", frameIndex);
+        return false;
+    }
+
+    return true;
+}
+
+void Decoder::applyDisposalMethodForFrame(const FrameInfo& info) {
+    switch (info.disposalMethod) {
+    case DISPOSE_BACKGROUND: //clear frame area to transparent
+        clearFrameAreaToTransparent(info.imageDesc);
+        break;
+    case DISPOSE_PREVIOUS: //restore previous canvas state
+        restoreFrameArea();
+        break;
+    default: //other disposal methods are treated as DISPOSE_DO_NOT
+        break;
+    };
+}
+
+bool Decoder::clampToCanvas(const GifImageDesc& imageDesc, int& left, int& top, int& width, int& height) const {
+    left = imageDesc.Left;
+    top = imageDesc.Top;
+    width = imageDesc.Width;
+    height = imageDesc.Height;
+
+    if (left < 0) { width += left; left = 0; }
+    if (top < 0) { height += top; top = 0; }
+    if (left + width > m_canvasWidth) width = m_canvasWidth - left;
+    if (top + height > m_canvasHeight) height = m_canvasHeight - top;
+
+    return width > 0 and height > 0;
+}
+
+bool Decoder::saveFrameArea(const GifImageDesc& imageDesc) {
+    m_savedWidth = 0;
+    m_savedHeight = 0;
+
+    int left, top, width, height;
+    if (!clampToCanvas(imageDesc, left, top, width, height)) return true;
+
+    if (!m_previousBuffer) {
+        m_previousBuffer = static_cast<GifByteType*>(malloc((size_t)m_canvasWidth * m_canvasHeight * m_bytesPerPixel));
+        if (!m_previousBuffer) return false;
+    }
+
+    size_t rowBytes = width * m_bytesPerPixel;
+    for (int y = 0; y < height; y++) {
+        memcpy(
+            m_previousBuffer + (size_t)y * rowBytes,
+            m_canvasBuffer + ((size_t)(top + y) * m_canvasWidth + left) * m_bytesPerPixel,
+            rowBytes
+        );
+    }
+
+    m_savedLeft = left;
+    m_savedTop = top;
+    m_savedWidth = width;
+    m_savedHeight = height;
+    return true;
+}
+
+void Decoder::restoreFrameArea() {
+    if (!m_previousBuffer) return;
+
+    size_t rowBytes = m_savedWidth * m_bytesPerPixel;
+    for (int y = 0; y < m_savedHeight; y++) {
+        GifByteType* canvasRow = m_canvasBuffer + ((size_t)(m_savedTop + y) * m_canvasWidth + m_savedLeft) * m_bytesPerPixel;
+        const GifByteType* savedRow = m_previousBuffer + (size_t)y * rowBytes;
+        if (memcmp(canvasRow, savedRow, rowBytes) == 0) continue;
+        memcpy(canvasRow, savedRow, rowBytes);
+        m_canvasChanged = true;
+    }
+}
+
+void Decoder::clearFrameAreaToTransparent(const GifImageDesc& imageDesc) {
+    int left, top, width, height;
+    if (!clampToCanvas(imageDesc, left, top, width, height)) return;
+
+    if (m_indexed) {
+        for (int y = top; y < top + height; y++) {
+            GifByteType* canvasRow = m_canvasBuffer + (size_t)y * m_canvasWidth + left;
+            for (int x = 0; x < width and !m_canvasChanged; x++) m_canvasChanged = canvasRow[x] != m_palette.transparentSlot;
+            memset(canvasRow, m_palette.transparentSlot, width);
+        }
+        return;
+    }
+
+    //clear area to transparent
+    for (int y = top; y < top + height; y++) {
+        for (int x = left; x < left + width; x++) {
+            size_t pixelIndex = ((size_t)y * m_canvasWidth + x) * 4;
+            //gif pixels are either fully transparent black or opaque, alpha alone tells if this changes anything
+            if (m_canvasBuffer[pixelIndex + 3]) m_canvasChanged = true;
+            m_canvasBuffer[pixelIndex] = 0;
+            m_canvasBuffer[pixelIndex + 1] = 0;
+            m_canvasBuffer[pixelIndex + 2] = 0;
+            m_canvasBuffer[pixelIndex + 3] = 0;
+        }
+    }
+}
+
+//tables and clipped rect for the frame streamFrame decodes next.
+//keep = false writes transparent for transparent/out of range indices instead of leaving the pixel
+bool Decoder::setupFrameJob(const GifImageDesc& imageDesc, ColorMapObject* colorMap, int transparentColorIndex, bool keep) {
+    if (!colorMap) return false;
+
+    //validate bounds
+    Compositor::Job& job = m_frameJob;
+    bool visible = clampToCanvas(imageDesc, job.left, job.top, job.width, job.height);
+    if (job.width != imageDesc.Width or job.height != imageDesc.Height) {
+        report(LogLevel::Warn, "Frame extends beyond canvas bounds: %dx%d at (%d,%d)", imageDesc.Width, imageDesc.Height, imageDesc.Left, imageDesc.Top);
+        if (!visible) return false;
+    }
+
+    job.canvas = m_canvasBuffer;
+    job.canvasWidth = m_canvasWidth;
+    job.rasterStride = imageDesc.Width;
+
+    if (m_indexed) {
+        GifByteType translation[256];
+        m_palette.translation(colorMap, translation);
+        m_frameTables.buildIndexed(translation, colorMap->ColorCount, transparentColorIndex, m_palette.transparentSlot, keep);
+    }
+    else m_frameTables.buildRGBA(colorMap, transparentColorIndex, keep);
+
+    m_frameComposite = Compositor::resolve(Compositor::select(m_frameTables, m_indexed));
+    return true;
+}
+
+//lzw decodes the current image of stream one row at a time and composites each row
+//while it is still in cache, no full frame index buffer in between.
+//interlaced images come in 4 passes, each row goes to its display row.
+//composite = false only decodes, keeps the stream in step for skipped frames
+bool Decoder::streamFrame(GifFileType* stream, bool composite) {
+    const GifImageDesc& desc = stream->Image;
+    if (desc.Width <= 0 or desc.Height <= 0) return false;
+    if (m_rowBuffer.size() < (size_t)desc.Width) m_rowBuffer.resize(desc.Width);
+
+    Compositor::Job row = m_frameJob;
+    row.raster = m_rowBuffer.data();
+    row.height = 1;
+
+    static const int interlacedOffset[] = { 0, 4, 2, 1 };
+    static const int interlacedJumps[] = { 8, 8, 4, 2 };
+    int passes = desc.Interlace ? 4 : 1;
+
+    //lzw vs composite is split by timing every 16th DGifGetLine and scaling up,
+    //a clock pair per row costs about as much as compositing a narrow row
+    const int sampleEvery = 16;
+    double sampledLzw = 0.0;
+    int rows = 0;
+    auto frameStart = Clock::now();
+    bool changed = false;
+    for (int pass = 0; pass < passes; pass++) {
+        int first = desc.Interlace ? interlacedOffset[pass] : 0;
+        int step = desc.Interlace ? interlacedJumps[pass] : 1;
+        for (int y = first; y < desc.Height; y += step) {
+            if (checkCancel()) return false;
+            int result;
+            if (composite and rows % sampleEvery == 0) {
+                auto lzwStart = Clock::now();
+                result = DGifGetLine(stream, m_rowBuffer.data(), desc.Width);
+                sampledLzw += secondsSince(lzwStart);
+            }
+            else result = DGifGetLine(stream, m_rowBuffer.data(), desc.Width);
+            rows++;
+            if (result == GIF_ERROR) return false;
+
+            //rows past the canvas are decoded but dropped
+            if (!composite or y >= m_frameJob.height) continue;
+            row.top = m_frameJob.top + y;
+            changed |= m_frameComposite(row, m_frameTables);
+        }
+    }
+
+    double total = secondsSince(frameStart);
+    if (!composite) m_timings.lzw += total;
+    else {
+        int sampled = (rows + sampleEvery - 1) / sampleEvery;
+        double lzw = std::min(total, sampledLzw * rows / sampled);
+        m_timings.lzw += lzw;
+        m_timings.composite += total - lzw;
+    }
+    if (changed) m_canvasChanged = true;
+    return true;
+}
+
+bool Decoder::checkCancel() {
+    if (m_cancel and m_cancel->load(std::memory_order_relaxed)) m_cancelled = true;
+    return m_cancelled;
+}
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <gifcore/Compositor.hpp>
+#include <gifcore/Palette.hpp>
+#include <gifcore/PixelConverter.hpp>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gifcore {
+
+//per frame data the decoder hands out, plain struct so it can live off the main thread
+struct FrameInfo {
+    float delay = 0.1f;
+    GifImageDesc imageDesc = {};
+    int disposalMethod = DISPOSE_DO_NOT;
+    int transparentColorIndex = NO_TRANSPARENT_COLOR;
+    //canvas is pixel identical to the previous frame handed out, consumers can fold its delay into that one
+    bool duplicate = false;
+};
+
+//fully composited gif kept in cpu memory, used by preload to move frames to the main thread
+struct DecodedGIF {
+    GifWord canvasWidth = 0;
+    GifWord canvasHeight = 0;
+    //size of the snapshots in pixels, below the canvas size once they were downscaled for upload
+    GifWord pixelWidth = 0;
+    GifWord pixelHeight = 0;
+    int imageCount = 0; //1 = static gif
+    bool hasTransparentBackground = false;
+    bool isOpaque = false;
+    PixelConverter::PaletteFit paletteFit;
+    bool indexed = false;
+    Palette palette;
+    std::vector<FrameInfo> frames; //duplicates already folded into the frame before them
+    int duplicateFrames = 0;
+    std::vector<std::vector<GifByteType>> pixels; //rgba8888 (or index when indexed) canvas snapshot per frame
+};
+
+//what probe() finds in the block structure, no pixel is decoded for it
+struct GIFInfo {
+    GifWord width = 0;
+    GifWord height = 0;
+    int frameCount = 0; //images in the file, decode merges identical consecutive ones so it can hand out fewer
+    float duration = 0.f; //seconds, every frame once with the same delay rules as decode
+    int loopCount = -1; //netscape application block: 0 = forever, -1 = no block
+};
+
+enum class LogLevel { Debug, Warn, Error };
+
+//seconds spent per stage, accumulated over every decode() of one decoder
+struct StageTimings {
+    double lzw = 0.0; //structure scan + row by row lzw decode
+    double disposal = 0.0; //restore/clear of previous frame + DISPOSE_PREVIOUS snapshots
+    double composite = 0.0; //palette lookup into the canvas
+};
+
+//decodes gif bytes and composites frames onto rgba canvas
+//(or 8 bit palette index canvas in indexed mode)
+//no cocos in here, builds without geode and is safe to run on any thread (one decoder per thread)
+class Decoder {
+public:
+    GifWord m_canvasWidth = 0;
+    GifWord m_canvasHeight = 0;
+    GifByteType* m_canvasBuffer = nullptr;
+    //holds only the rect of the last DISPOSE_PREVIOUS frame, allocated on first use
+    GifByteType* m_previousBuffer = nullptr;
+    int m_savedLeft = 0;
+    int m_savedTop = 0;
+    int m_savedWidth = 0;
+    int m_savedHeight = 0;
+    ColorMapObject* m_globalColorMap = nullptr;
+    bool m_hasTransparentBackground = false;
+    //no pixel of any composited frame can end up transparent
+    bool m_isOpaque = false;
+    PixelConverter::PaletteFit m_paletteFit;
+    //set before decode to ask for index canvas, m_indexed says if the gif allowed it
+    bool m_requestIndexed = false;
+    bool m_indexed = false;
+    Palette m_palette;
+    int m_bytesPerPixel = 4;
+    //frames in the file, known before the first callback. 1 takes the static path
+    int m_imageCount = 0;
+    //set whenever disposal or rendering actually changes a pixel, cleared after each handed out frame
+    bool m_canvasChanged = true;
+    //bigger canvases are rejected before any frame is read, also keeps pixel offsets far from overflow
+    size_t m_maxCanvasPixels = 8192 * 8192;
+    //set from another thread to stop the decode, checked before every frame and row.
+    //m_cancelled says a failed decode stopped because of it, nothing is logged as error then
+    const std::atomic<bool>* m_cancel = nullptr;
+    bool m_cancelled = false;
+    //one decoded index row, composited before the next one is decoded
+    std::vector<GifByteType> m_rowBuffer;
+    //set up per frame by setupFrameJob, used for every row of that frame
+    Compositor::Job m_frameJob;
+    Compositor::Tables m_frameTables;
+    Compositor::Fn m_frameComposite = nullptr;
+
+    //last error and everything that was skipped on the way, kept for callers without a log sink
+    std::string m_error;
+    std::vector<std::string> m_warnings;
+    StageTimings m_timings;
+
+    //called for every composited frame, canvas is valid only during the call
+    using FrameCallback = std::function<bool(const FrameInfo& info, const GifByteType* canvas)>;
+    //optional sink, the mod points it at geode log
+    using LogCallback = std::function<void(LogLevel level, const std::string& message)>;
+    LogCallback m_log;
+
+    Decoder() = default;
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+    ~Decoder();
+
+    bool decode(const unsigned char* fileData, unsigned long fileSize, const std::string& name, FrameCallback const& onFrame);
+    //decode everything into cpu side snapshots
+    bool decodeAll(const unsigned char* fileData, unsigned long fileSize, const std::string& name, DecodedGIF& out);
+
+    //size, frames, duration and loop count only. lzw data is skipped block by block, never decompressed
+    bool probe(const unsigned char* fileData, unsigned long fileSize, const std::string& name, GIFInfo& out);
+
+    bool checkCanvasSize(GifWord width, GifWord height);
+    //fills SavedImages without RasterBits, everything analyzeFrames and readFrameInfo need
+    bool scanStructure(GifFileType* gifFile);
+    //same walk keeping nothing but the counts
+    bool probeBlocks(GifFileType* gifFile, GIFInfo& out);
+    //gifFile is the scanned handle, stream a second one over the same bytes that pixels are decoded from
+    bool processGIFData(GifFileType* gifFile, GifFileType* stream, FrameCallback const& onFrame);
+    //palette and coverage scan, lets the uploader pick a smaller texture format up front
+    void analyzeFrames(GifFileType* gifFile);
+    //one frame gifs skip disposal state and the global map copy entirely
+    bool processSingleFrame(GifFileType* gifFile, GifFileType* stream, FrameCallback const& onFrame);
+    void initializeCanvas();
+    void readFrameInfo(FrameInfo& info, SavedImage* savedImage, GifFileType* gifFile, int frameIndex);
+    bool processFrame(FrameInfo& info, SavedImage* savedImage, GifFileType* gifFile, int frameIndex, const FrameInfo* prevInfo);
+    void applyDisposalMethodForFrame(const FrameInfo& info);
+    //frame rect clipped to canvas, false when nothing is left
+    bool clampToCanvas(const GifImageDesc& imageDesc, int& left, int& top, int& width, int& height) const;
+    //copy the rows under this frame rect into compact previous buffer
+    bool saveFrameArea(const GifImageDesc& imageDesc);
+    void restoreFrameArea();
+    void clearFrameAreaToTransparent(const GifImageDesc& imageDesc);
+    //skips extensions up to the next image descriptor of stream and reads it
+    bool nextImage(GifFileType* stream);
+    bool setupFrameJob(const GifImageDesc& imageDesc, ColorMapObject* colorMap, int transparentColorIndex, bool keep);
+    bool streamFrame(GifFileType* stream, bool composite);
+    bool checkCancel();
+
+private:
+    void report(LogLevel level, const char* format, ...);
+};
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <gif_lib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace gifcore {
+
+//one palette for the whole gif, local color maps get remapped into it
+//so every frame composites into the same index space
+struct Palette {
+    GifByteType colors[256 * 4] = {}; //rgba, ready for the 256x1 palette texture
+    int colorCount = 0;
+    GifByteType transparentSlot = 0;
+    std::unordered_map<uint32_t, GifByteType> lookup;
+
+    static uint32_t pack(const GifColorType& c) {
+        return (uint32_t)c.Red << 16 | (uint32_t)c.Green << 8 | c.Blue;
+    }
+
+    //false when the union needs more than 255 colors (one slot is kept for transparency)
+    bool add(const ColorMapObject* colorMap) {
+        if (!colorMap) return true;
+        for (int i = 0; i < colorMap->ColorCount; i++) {
+            auto& c = colorMap->Colors[i];
+            if (lookup.count(pack(c))) continue;
+            if (colorCount >= 255) return false;
+
+            lookup[pack(c)] = (GifByteType)colorCount;
+            colors[colorCount * 4] = c.Red;
+            colors[colorCount * 4 + 1] = c.Green;
+            colors[colorCount * 4 + 2] = c.Blue;
+            colors[colorCount * 4 + 3] = 255;
+            colorCount++;
+        }
+        return true;
+    }
+
+    void finalize() {
+        transparentSlot = (GifByteType)colorCount;
+        memset(colors + transparentSlot * 4, 0, 4);
+    }
+
+    //frame color index -> palette index, out of range indices map to transparent slot
+    void translation(const ColorMapObject* colorMap, GifByteType out[256]) const {
+        for (int i = 0; i < 256; i++) {
+            if (i >= colorMap->ColorCount) {
+                out[i] = transparentSlot;
+                continue;
+            }
+            auto it = lookup.find(pack(colorMap->Colors[i]));
+            out[i] = it != lookup.end() ? it->second : transparentSlot;
+        }
+    }
+};
+
+}
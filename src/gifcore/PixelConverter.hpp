@@ -0,0 +1,79 @@
+#pragma once
+
+#include <gif_lib.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gifcore {
+
+//rgba8888 -> smaller texture formats, plain loops without cocos so they work anywhere
+struct PixelConverter {
+    static void toRGBA4444(const GifByteType* src, uint16_t* dst, size_t pixelCount) {
+        for (size_t i = 0; i < pixelCount; i++, src += 4) {
+            dst[i] = (uint16_t)(((src[0] >> 4) << 12) | ((src[1] >> 4) << 8) | ((src[2] >> 4) << 4) | (src[3] >> 4));
+        }
+    }
+
+    static void toRGB5A1(const GifByteType* src, uint16_t* dst, size_t pixelCount) {
+        for (size_t i = 0; i < pixelCount; i++, src += 4) {
+            dst[i] = (uint16_t)(((src[0] >> 3) << 11) | ((src[1] >> 3) << 6) | ((src[2] >> 3) << 1) | (src[3] >> 7));
+        }
+    }
+
+    static void toRGB565(const GifByteType* src, uint16_t* dst, size_t pixelCount) {
+        for (size_t i = 0; i < pixelCount; i++, src += 4) {
+            dst[i] = (uint16_t)(((src[0] >> 3) << 11) | ((src[1] >> 2) << 5) | (src[2] >> 3));
+        }
+    }
+
+    //drops alpha, only for canvases that are known to be opaque
+    static void toRGB888(const GifByteType* src, GifByteType* dst, size_t pixelCount) {
+        for (size_t i = 0; i < pixelCount; i++, src += 4, dst += 3) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+
+    //true if gpu expands the truncated channel back to the exact same 8 bit value.
+    //gl reads n bits as q / (2^n - 1), not by repeating the top bits (5 bit 3 is 24.7, so 24 doesnt fit)
+    static bool fits(GifByteType v, int bits) {
+        int max = (1 << bits) - 1;
+        int q = v >> (8 - bits);
+        return (q * 510 + max) / (2 * max) == v;
+    }
+    static bool fits4(GifByteType v) { return fits(v, 4); }
+    static bool fits5(GifByteType v) { return fits(v, 5); }
+    static bool fits6(GifByteType v) { return fits(v, 6); }
+
+    //which 16 bit formats can hold every palette color without loss
+    struct PaletteFit {
+        bool rgba4444 = true;
+        bool rgb5a1 = true;
+        bool rgb565 = true;
+
+        void add(const ColorMapObject* colorMap) {
+            if (!colorMap) return;
+            for (int i = 0; i < colorMap->ColorCount; i++) {
+                auto& c = colorMap->Colors[i];
+                rgba4444 = rgba4444 and fits4(c.Red) and fits4(c.Green) and fits4(c.Blue);
+                rgb5a1 = rgb5a1 and fits5(c.Red) and fits5(c.Green) and fits5(c.Blue);
+                rgb565 = rgb565 and fits5(c.Red) and fits6(c.Green) and fits5(c.Blue);
+            }
+        }
+    };
+
+    enum class Format { RGBA8888, RGB888, RGBA4444, RGB5A1, RGB565 };
+
+    //what Auto uploads as. gif alpha is 0 or 255 so 16 bit alpha is exact, only colors decide:
+    //a 16 bit format exactly when every palette color comes back unchanged from it
+    static Format autoFormat(bool isOpaque, PaletteFit const& fit) {
+        if (isOpaque and fit.rgb565) return Format::RGB565;
+        if (fit.rgb5a1) return Format::RGB5A1;
+        if (fit.rgba4444) return Format::RGBA4444;
+        return isOpaque ? Format::RGB888 : Format::RGBA8888;
+    }
+};
+
+}
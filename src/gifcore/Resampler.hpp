@@ -0,0 +1,203 @@
+#pragma once
+
+#include <gif_lib.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace gifcore {
+
+//canvas -> smaller texture before upload, for gifs that are never drawn at full size.
+//rgba is averaged with alpha as weight so the transparent black around shapes doesnt darken their edges,
+//index canvases can only be point sampled. plain integer loops like PixelConverter, no cocos
+struct Resampler {
+    //canvas fitted under maxSide (longest side in pixels) and maxScale, 0 = no limit.
+    //never upscales and never goes below 1x1
+    static void targetSize(int width, int height, unsigned int maxSide, float maxScale, int& outWidth, int& outHeight) {
+        double scale = 1.0;
+        if (maxScale > 0.f and maxScale < 1.f) scale = maxScale;
+        int longest = std::max(width, height);
+        if (maxSide > 0 and longest * scale > maxSide) scale = (double)maxSide / longest;
+        outWidth = std::clamp((int)(width * scale + 0.5), 1, std::max(width, 1));
+        outHeight = std::clamp((int)(height * scale + 0.5), 1, std::max(height, 1));
+    }
+
+    //whole pixels per output pixel taken by the box pass, the rest (under 2x) is left to bilinear
+    static int boxFactor(int size, int dstSize) { return std::max(1, size / dstSize); }
+    static int boxSize(int size, int factor) { return (size + factor - 1) / factor; }
+
+    //bytes downscaleRGBA needs as scratch, 0 when one pass is enough
+    static size_t scratchBytes(int width, int height, int dstWidth, int dstHeight) {
+        int fx = boxFactor(width, dstWidth), fy = boxFactor(height, dstHeight);
+        int bw = boxSize(width, fx), bh = boxSize(height, fy);
+        if ((fx == 1 and fy == 1) or (bw == dstWidth and bh == dstHeight)) return 0;
+        return (size_t)bw * bh * 4;
+    }
+
+    //box filter by the integer part of the ratio, then bilinear for what is left
+    static void downscaleRGBA(const GifByteType* src, int width, int height, GifByteType* dst, int dstWidth, int dstHeight, GifByteType* scratch) {
+        int fx = boxFactor(width, dstWidth), fy = boxFactor(height, dstHeight);
+        int bw = boxSize(width, fx), bh = boxSize(height, fy);
+        if (fx == 1 and fy == 1) {
+            if (width == dstWidth and height == dstHeight) memcpy(dst, src, (size_t)width * height * 4);
+            else bilinearRGBA(src, width, height, dst, dstWidth, dstHeight);
+            return;
+        }
+        if (bw == dstWidth and bh == dstHeight) {
+            boxRGBA(src, width, height, fx, fy, dst);
+            return;
+        }
+        boxRGBA(src, width, height, fx, fy, scratch);
+        bilinearRGBA(scratch, bw, bh, dst, dstWidth, dstHeight);
+    }
+
+    //fx x fy blocks averaged into one pixel, dst is boxSize(width, fx) x boxSize(height, fy).
+    //blocks at the right/bottom edge may be partial, they average what they have
+    static void boxRGBA(const GifByteType* src, int width, int height, int fx, int fy, GifByteType* dst) {
+        //255 * 255 per pixel, 32 bit sums hold blocks up to 66051 pixels
+        if ((int64_t)fx * fy <= 66051) boxRGBA<uint32_t>(src, width, height, fx, fy, dst);
+        else boxRGBA<uint64_t>(src, width, height, fx, fy, dst);
+    }
+
+    template <typename Sum>
+    static void boxRGBA(const GifByteType* src, int width, int height, int fx, int fy, GifByteType* dst) {
+        const int dstWidth = boxSize(width, fx);
+        const int dstHeight = boxSize(height, fy);
+        //per output column: r*a, g*a, b*a, a
+        std::vector<Sum> sums((size_t)dstWidth * 4);
+
+        for (int dy = 0; dy < dstHeight; dy++) {
+            std::fill(sums.begin(), sums.end(), 0);
+            const int y0 = dy * fy, y1 = std::min(y0 + fy, height);
+            for (int y = y0; y < y1; y++) {
+                const GifByteType* row = src + (size_t)y * width * 4;
+                for (int dx = 0; dx < dstWidth; dx++) {
+                    const int x0 = dx * fx, x1 = std::min(x0 + fx, width);
+                    Sum r = 0, g = 0, b = 0, a = 0;
+                    for (int x = x0; x < x1; x++) {
+                        const GifByteType* p = row + (size_t)x * 4;
+                        r += p[0] * p[3];
+                        g += p[1] * p[3];
+                        b += p[2] * p[3];
+                        a += p[3];
+                    }
+                    Sum* sum = &sums[(size_t)dx * 4];
+                    sum[0] += r;
+                    sum[1] += g;
+                    sum[2] += b;
+                    sum[3] += a;
+                }
+            }
+
+            GifByteType* out = dst + (size_t)dy * dstWidth * 4;
+            for (int dx = 0; dx < dstWidth; dx++, out += 4) {
+                const Sum* sum = &sums[(size_t)dx * 4];
+                uint64_t count = (uint64_t)(y1 - y0) * (std::min(dx * fx + fx, width) - dx * fx);
+                store(out, sum[0], sum[1], sum[2], sum[3], (sum[3] + count / 2) / count);
+            }
+        }
+    }
+
+    //2x2 taps at pixel centers, weights in 8 bit fixed point. separable: source rows are interpolated
+    //horizontally once (premultiplied, reused by neighbouring output rows), then blended vertically
+    //as flat u32 arrays the compiler can vectorize
+    static void bilinearRGBA(const GifByteType* src, int width, int height, GifByteType* dst, int dstWidth, int dstHeight) {
+        struct Tap {
+            int i0, i1;
+            uint32_t w1; //weight of i1, i0 gets 256 - w1
+        };
+        auto taps = [](int size, int dstSize) {
+            std::vector<Tap> out(dstSize);
+            for (int d = 0; d < dstSize; d++) {
+                double pos = std::max(0.0, (d + 0.5) * size / dstSize - 0.5);
+                int i0 = std::min((int)pos, size - 1);
+                out[d] = { i0, std::min(i0 + 1, size - 1), (uint32_t)((pos - i0) * 256.0 + 0.5) };
+            }
+            return out;
+        };
+        const auto xs = taps(width, dstWidth);
+        const auto ys = taps(height, dstHeight);
+
+        //premultiplied r*a, g*a, b*a, a per output column, all fit 32 bits through both passes
+        const size_t rowValues = (size_t)dstWidth * 4;
+        std::vector<uint32_t> rows(rowValues * 2);
+        int rowIndex[2] = { -1, -1 };
+        auto horizontal = [&](int y, uint32_t* out) {
+            const GifByteType* row = src + (size_t)y * width * 4;
+            for (int dx = 0; dx < dstWidth; dx++, out += 4) {
+                const GifByteType* p0 = row + (size_t)xs[dx].i0 * 4;
+                const GifByteType* p1 = row + (size_t)xs[dx].i1 * 4;
+                const uint32_t w1 = xs[dx].w1, w0 = 256 - w1;
+                const uint32_t a0 = w0 * p0[3], a1 = w1 * p1[3];
+                out[0] = a0 * p0[0] + a1 * p1[0];
+                out[1] = a0 * p0[1] + a1 * p1[1];
+                out[2] = a0 * p0[2] + a1 * p1[2];
+                out[3] = a0 + a1;
+            }
+        };
+        auto sourceRow = [&](int y) -> const uint32_t* {
+            for (int i = 0; i < 2; i++) {
+                if (rowIndex[i] == y) return &rows[i * rowValues];
+            }
+            //replace the row the next output row wont need, rows only move down
+            int slot = rowIndex[0] < rowIndex[1] ? 0 : 1;
+            rowIndex[slot] = y;
+            horizontal(y, &rows[slot * rowValues]);
+            return &rows[slot * rowValues];
+        };
+
+        std::vector<uint32_t> blended(rowValues);
+        for (int dy = 0; dy < dstHeight; dy++) {
+            const Tap& ty = ys[dy];
+            const uint32_t* r0 = sourceRow(ty.i0);
+            const uint32_t* r1 = sourceRow(ty.i1);
+            const uint32_t w1 = ty.w1, w0 = 256 - w1;
+            for (size_t i = 0; i < rowValues; i++) blended[i] = w0 * r0[i] + w1 * r1[i];
+
+            GifByteType* out = dst + (size_t)dy * dstWidth * 4;
+            for (int dx = 0; dx < dstWidth; dx++, out += 4) {
+                const uint32_t* v = &blended[(size_t)dx * 4];
+                //opaque taps (most of any gif) divide by a constant
+                if (v[3] == 255u << 16) {
+                    for (int c = 0; c < 3; c++) out[c] = (GifByteType)((v[c] + (255u << 15)) / (255u << 16));
+                    out[3] = 255;
+                }
+                else store(out, v[0], v[1], v[2], v[3], (v[3] + 32768) >> 16);
+            }
+        }
+    }
+
+    //nearest pixel, any pixel size. the only option for palette indices
+    static void pointSample(const GifByteType* src, int width, int height, int bytesPerPixel, GifByteType* dst, int dstWidth, int dstHeight) {
+        std::vector<int> xs(dstWidth);
+        for (int dx = 0; dx < dstWidth; dx++) xs[dx] = (int)(((int64_t)dx * 2 + 1) * width / (2 * (int64_t)dstWidth));
+        for (int dy = 0; dy < dstHeight; dy++) {
+            int y = (int)(((int64_t)dy * 2 + 1) * height / (2 * (int64_t)dstHeight));
+            const GifByteType* row = src + (size_t)y * width * bytesPerPixel;
+            GifByteType* out = dst + (size_t)dy * dstWidth * bytesPerPixel;
+            for (int dx = 0; dx < dstWidth; dx++, out += bytesPerPixel) {
+                memcpy(out, row + (size_t)xs[dx] * bytesPerPixel, bytesPerPixel);
+            }
+        }
+    }
+
+private:
+    //color sums are alpha weighted, fully transparent output stays transparent black like the canvas
+    static void store(GifByteType* out, uint64_t r, uint64_t g, uint64_t b, uint64_t alphaWeight, uint64_t alpha) {
+        if (alphaWeight == 0) {
+            memset(out, 0, 4);
+            return;
+        }
+        //one division per pixel instead of one per channel
+        double inv = 1.0 / (double)alphaWeight;
+        out[0] = (GifByteType)(r * inv + 0.5);
+        out[1] = (GifByteType)(g * inv + 0.5);
+        out[2] = (GifByteType)(b * inv + 0.5);
+        out[3] = (GifByteType)alpha;
+    }
+};
+
+}
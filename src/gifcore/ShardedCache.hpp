@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gifcore {
+
+//string keyed map split into shards by key hash, each behind its own plain mutex, so a lookup
+//from a worker only locks one shard and doesnt wait on inserts into the others.
+//plain mutex and not shared_mutex: critical sections are one hash lookup, shared_mutex lost at every
+//thread count in --cache-stress. the key is hashed once for both the shard and the map lookup.
+//on a single core (no contention possible) the shards run within about 5% of one lock, what they win
+//under contention has only been argued, not measured here: run --cache-stress N on a multi core device
+//values are shared_ptr: whatever a reader got stays alive after its entry is erased. removed values are
+//returned instead of destroyed in here, so no deleter ever runs under a shard lock
+template <typename Value, size_t ShardCount = 16>
+class ShardedCache {
+public:
+    using Pointer = std::shared_ptr<Value>;
+
+    Pointer find(const std::string& key) const {
+        Hashed hashed{ key, Hash{}(key) };
+        auto& shard = shardFor(hashed);
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.map.find(hashed);
+        return it != shard.map.end() ? it->second : nullptr;
+    }
+
+    bool contains(const std::string& key) const {
+        Hashed hashed{ key, Hash{}(key) };
+        auto& shard = shardFor(hashed);
+        std::lock_guard lock(shard.mutex);
+        return shard.map.count(hashed);
+    }
+
+    //returns the value it replaced
+    Pointer insert(const std::string& key, Pointer value) {
+        Hashed hashed{ key, Hash{}(key) };
+        auto& shard = shardFor(hashed);
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.map.find(hashed);
+        //only a new key pays for a second hash, heterogeneous emplace is c++26
+        if (it == shard.map.end()) it = shard.map.emplace(key, nullptr).first;
+        std::swap(it->second, value);
+        return value;
+    }
+
+    Pointer erase(const std::string& key) {
+        Hashed hashed{ key, Hash{}(key) };
+        auto& shard = shardFor(hashed);
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.map.find(hashed);
+        if (it == shard.map.end()) return nullptr;
+        Pointer value = std::move(it->second);
+        shard.map.erase(it);
+        return value;
+    }
+
+    //pred(key, value), one shard locked at a time
+    template <typename Pred>
+    std::vector<Pointer> eraseIf(Pred&& pred) {
+        std::vector<Pointer> removed;
+        for (auto& shard : m_shards) {
+            std::lock_guard lock(shard.mutex);
+            for (auto it = shard.map.begin(); it != shard.map.end();) {
+                if (pred(it->first, *it->second)) {
+                    removed.push_back(std::move(it->second));
+                    it = shard.map.erase(it);
+                }
+                else ++it;
+            }
+        }
+        return removed;
+    }
+
+    std::vector<Pointer> clear() {
+        return eraseIf([](const std::string&, const Value&) { return true; });
+    }
+
+    //not a snapshot, shards are counted one after another
+    size_t size() const {
+        size_t count = 0;
+        for (auto& shard : m_shards) {
+            std::lock_guard lock(shard.mutex);
+            count += shard.map.size();
+        }
+        return count;
+    }
+
+    //fn(key, value) under the shards lock, fn must not touch the cache
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (auto& shard : m_shards) {
+            std::lock_guard lock(shard.mutex);
+            for (auto& [key, value] : shard.map) fn(key, *value);
+        }
+    }
+
+private:
+    //key with its hash, picks the shard and is looked up in its map without hashing the string again
+    struct Hashed {
+        const std::string& key;
+        size_t hash;
+    };
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(const std::string& key) const { return std::hash<std::string>{}(key); }
+        size_t operator()(Hashed const& hashed) const { return hashed.hash; }
+    };
+    struct Equal {
+        using is_transparent = void;
+        bool operator()(const std::string& a, const std::string& b) const { return a == b; }
+        bool operator()(Hashed const& a, const std::string& b) const { return a.key == b; }
+        bool operator()(const std::string& a, Hashed const& b) const { return a == b.key; }
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Pointer, Hash, Equal> map;
+    };
+    std::array<Shard, ShardCount> m_shards;
+
+    Shard& shardFor(Hashed const& hashed) { return m_shards[hashed.hash % ShardCount]; }
+    const Shard& shardFor(Hashed const& hashed) const { return m_shards[hashed.hash % ShardCount]; }
+};
+
+}
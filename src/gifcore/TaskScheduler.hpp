@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gifcore {
+
+//shared by whoever queued a job and the job itself. priority is read when a worker picks the next job,
+//so raising it moves a job that is still waiting up. cancelled drops it if it hasnt started, a running
+//job has to look at the flag itself (Decoder::m_cancel)
+struct JobControl {
+    std::atomic<bool> cancelled = false;
+    std::atomic<int> priority = 0;
+};
+
+//worker pool for decode jobs. submit() puts jobs into one shared queue, highest priority first and fifo
+//inside a priority. a running job can split off parts with spawn(): they go onto that workers own deque,
+//which it works through newest first before taking anything new, and idle workers steal the oldest of them.
+//tasks are whole decodes or frame sized, so one lock over all queues costs nothing next to them.
+//no cocos, the mod and gif_bench both use it
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    struct Stats {
+        size_t executed = 0;
+        size_t spawned = 0;
+        size_t stolen = 0;
+        size_t cancelled = 0; //dropped before they started
+    };
+
+    //0 = one per core
+    explicit TaskScheduler(unsigned int workers = 0) {
+        if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < workers; i++) m_workers.push_back(std::make_unique<Worker>());
+        for (unsigned int i = 0; i < workers; i++) m_workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+    }
+
+    //running tasks finish, queued ones are dropped
+    ~TaskScheduler() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) worker->thread.join();
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    size_t workerCount() const { return m_workers.size(); }
+
+    void submit(Task task, std::shared_ptr<JobControl> control = nullptr) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_queue.push_back({ std::move(task), std::move(control), m_nextOrder++ });
+            m_available++;
+        }
+        m_wake.notify_one();
+    }
+
+    //part of the running job, onto this workers deque. outside a worker its just submit()
+    void spawn(Task task, std::shared_ptr<JobControl> control = nullptr) {
+        if (t_scheduler != this) return submit(std::move(task), std::move(control));
+        {
+            std::lock_guard lock(m_mutex);
+            m_workers[t_worker]->local.push_back({ std::move(task), std::move(control), 0 });
+            m_stats.spawned++;
+            m_available++;
+        }
+        m_wake.notify_one();
+    }
+
+    //until nothing is queued or running, for tools and tests
+    void wait() {
+        std::unique_lock lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_available == 0 and m_running == 0; });
+    }
+
+    Stats stats() {
+        std::lock_guard lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    struct Entry {
+        Task task;
+        std::shared_ptr<JobControl> control;
+        uint64_t order = 0;
+    };
+
+    struct Worker {
+        std::deque<Entry> local; //guarded by m_mutex too
+        std::thread thread;
+    };
+
+    inline static thread_local TaskScheduler* t_scheduler = nullptr;
+    inline static thread_local size_t t_worker = 0;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_mutex; //everything below
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::vector<Entry> m_queue;
+    uint64_t m_nextOrder = 0;
+    size_t m_available = 0; //queued plus spawned, not taken yet
+    size_t m_running = 0;
+    bool m_stopping = false;
+    Stats m_stats;
+
+    static int priorityOf(Entry const& entry) {
+        return entry.control ? entry.control->priority.load(std::memory_order_relaxed) : 0;
+    }
+
+    //own deque newest first, then the shared queue, then the oldest part of someone elses job.
+    //caller holds m_mutex
+    bool take(size_t index, Entry& out) {
+        auto& own = m_workers[index]->local;
+        if (!own.empty()) {
+            out = std::move(own.back());
+            own.pop_back();
+            return true;
+        }
+
+        if (!m_queue.empty()) {
+            auto best = m_queue.begin();
+            int bestPriority = priorityOf(*best);
+            for (auto it = m_queue.begin() + 1; it != m_queue.end(); ++it) {
+                int priority = priorityOf(*it);
+                if (priority > bestPriority or (priority == bestPriority and it->order < best->order)) {
+                    best = it;
+                    bestPriority = priority;
+                }
+            }
+            out = std::move(*best);
+            m_queue.erase(best);
+            return true;
+        }
+
+        for (size_t i = 1; i < m_workers.size(); i++) {
+            auto& victim = m_workers[(index + i) % m_workers.size()]->local;
+            if (!victim.empty()) {
+                out = std::move(victim.front());
+                victim.pop_front();
+                m_stats.stolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        t_scheduler = this;
+        t_worker = index;
+
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [this] { return m_stopping or m_available > 0; });
+            if (m_stopping) return;
+
+            Entry entry;
+            if (!take(index, entry)) continue;
+            m_available--;
+
+            if (entry.control and entry.control->cancelled.load(std::memory_order_relaxed)) {
+                m_stats.cancelled++;
+                if (m_available == 0 and m_running == 0) m_idle.notify_all();
+                continue;
+            }
+
+            m_running++;
+            lock.unlock();
+            entry.task();
+            entry = Entry();
+            lock.lock();
+            m_running--;
+            m_stats.executed++;
+            if (m_available == 0 and m_running == 0) m_idle.notify_all();
+        }
+    }
+};
+
+}
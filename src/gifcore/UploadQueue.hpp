@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace gifcore {
+
+//how much one drain() may do, checked between uploads
+struct UploadBudget {
+    double seconds = 0.004;
+    size_t bytes = 0; //0 = no byte limit
+};
+
+//Skipped: nothing left to do (already uploaded out of turn), not counted anywhere
+enum class UploadResult { Uploaded, Failed, Dropped, Skipped };
+
+struct UploadStats {
+    size_t uploaded = 0;
+    size_t failed = 0;
+    size_t dropped = 0; //uploader said nobody needs it anymore
+    size_t bytes = 0; //uploaded items only
+    size_t pending = 0;
+    size_t drains = 0; //drain() calls that had something to do
+    size_t deferredDrains = 0; //ran out of budget with items left
+    double seconds = 0.0; //drains and flushes
+    double maxDrainSeconds = 0.0;
+};
+
+//items waiting for the gpu, a budget worth is drained per tick on the gl thread.
+//earliest needed goes first: higher priority, then earlier playback time, then push order.
+//the uploader is a plain callable and the clock is replaceable, so the scheduling can run without gl
+template <typename Payload>
+class UploadQueue {
+public:
+    struct Item {
+        Payload payload;
+        int priority = 0;
+        double neededAt = 0.0; //seconds into playback the item is first shown
+        size_t bytes = 0;
+        uint64_t order = 0;
+    };
+
+    UploadBudget m_budget;
+    UploadStats m_stats;
+    std::function<double()> m_now = [] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+
+    void push(Payload payload, int priority, double neededAt, size_t bytes) {
+        m_items.push_back({ std::move(payload), priority, neededAt, bytes, m_nextOrder++ });
+        std::push_heap(m_items.begin(), m_items.end(), later);
+        m_stats.pending = m_items.size();
+    }
+
+    bool empty() const { return m_items.empty(); }
+    size_t size() const { return m_items.size(); }
+
+    //uploads until the time or byte budget is spent. the first item always goes,
+    //so a frame bigger than the whole budget still gets through. uploader(Payload&) -> UploadResult
+    template <typename Uploader>
+    size_t drain(Uploader&& uploader) {
+        if (m_items.empty()) return 0;
+
+        const double start = m_now();
+        size_t bytes = 0;
+        size_t count = 0;
+        m_stats.drains++;
+        while (!m_items.empty()) {
+            if (count > 0) {
+                bool outOfTime = m_now() - start >= m_budget.seconds;
+                bool outOfBytes = m_budget.bytes and bytes + m_items.front().bytes > m_budget.bytes;
+                if (outOfTime or outOfBytes) {
+                    m_stats.deferredDrains++;
+                    break;
+                }
+            }
+            std::pop_heap(m_items.begin(), m_items.end(), later);
+            Item item = std::move(m_items.back());
+            m_items.pop_back();
+            if (upload(item, uploader)) bytes += item.bytes;
+            count++;
+        }
+
+        const double elapsed = m_now() - start;
+        m_stats.seconds += elapsed;
+        m_stats.maxDrainSeconds = std::max(m_stats.maxDrainSeconds, elapsed);
+        m_stats.pending = m_items.size();
+        return count;
+    }
+
+    //uploads every matching item right away, outside the budget (something has to show it this frame)
+    template <typename Match, typename Uploader>
+    size_t flush(Match&& match, Uploader&& uploader) {
+        auto split = std::stable_partition(m_items.begin(), m_items.end(), [&](Item const& item) { return !match(item.payload); });
+        if (split == m_items.end()) return 0;
+
+        std::vector<Item> taken(std::make_move_iterator(split), std::make_move_iterator(m_items.end()));
+        m_items.erase(split, m_items.end());
+        std::make_heap(m_items.begin(), m_items.end(), later);
+
+        const double start = m_now();
+        for (auto& item : taken) upload(item, uploader);
+        m_stats.seconds += m_now() - start;
+        m_stats.pending = m_items.size();
+        return taken.size();
+    }
+
+private:
+    std::vector<Item> m_items; //heap, front is the next upload
+    uint64_t m_nextOrder = 0;
+
+    //heap comparator, true when a goes after b
+    static bool later(Item const& a, Item const& b) {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        if (a.neededAt != b.neededAt) return a.neededAt > b.neededAt;
+        return a.order > b.order;
+    }
+
+    //true if it went up
+    template <typename Uploader>
+    bool upload(Item& item, Uploader& uploader) {
+        switch (uploader(item.payload)) {
+        case UploadResult::Uploaded:
+            m_stats.uploaded++;
+            m_stats.bytes += item.bytes;
+            return true;
+        case UploadResult::Failed:
+            m_stats.failed++;
+            return false;
+        case UploadResult::Skipped:
+            return false;
+        default:
+            m_stats.dropped++;
+            return false;
+        }
+    }
+};
+
+}
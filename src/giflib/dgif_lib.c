@@ -422,7 +422,8 @@ DGifGetImageDesc(GifFileType *GifFile)
        (long)GifFile->Image.Height;
 
     /* Reset decompress algorithm parameters. */
-    (void)DGifSetupDecompress(GifFile);
+    if (DGifSetupDecompress(GifFile) == GIF_ERROR)
+        return GIF_ERROR;
 
     return GIF_OK;
 }
@@ -750,9 +751,18 @@ DGifSetupDecompress(GifFileType *GifFile)
     GifPrefixType *Prefix;
     GifFilePrivateType *Private = (GifFilePrivateType *)GifFile->Private;
 
-    READ(GifFile, &CodeSize, 1);    /* Read Code size from file. */
+    if (READ(GifFile, &CodeSize, 1) < 1) {    /* Read Code size from file. */
+        GifFile->Error = D_GIF_ERR_READ_FAILED;
+        return GIF_ERROR;
+    }
     BitsPerPixel = CodeSize;
 
+    /* only a malformed file gets here, larger sizes overflow the code tables */
+    if (BitsPerPixel > 8) {
+        GifFile->Error = D_GIF_ERR_READ_FAILED;
+        return GIF_ERROR;
+    }
+
     Private->Buf[0] = 0;    /* Input Buffer empty. */
     Private->BitsPerPixel = BitsPerPixel;
     Private->ClearCode = (1 << BitsPerPixel);
@@ -1083,11 +1093,11 @@ DGifSlurp(GifFileType *GifFile)
 
               sp = &GifFile->SavedImages[GifFile->ImageCount - 1];
               /* Allocate memory for the image */
-              if (sp->ImageDesc.Width < 0 && sp->ImageDesc.Height < 0 &&
+              if (sp->ImageDesc.Width <= 0 || sp->ImageDesc.Height <= 0 ||
                       sp->ImageDesc.Width > (INT_MAX / sp->ImageDesc.Height)) {
                   return GIF_ERROR;
               }
-              ImageSize = sp->ImageDesc.Width * sp->ImageDesc.Height;
+              ImageSize = (size_t)sp->ImageDesc.Width * sp->ImageDesc.Height;
 
               if (ImageSize > (SIZE_MAX / sizeof(GifPixelType))) {
                   return GIF_ERROR;
@@ -1136,7 +1146,9 @@ DGifSlurp(GifFileType *GifFile)
               if (DGifGetExtension(GifFile,&ExtFunction,&ExtData) == GIF_ERROR)
                   return (GIF_ERROR);
 	      /* Create an extension block with our data */
-	      if (GifAddExtensionBlock(&GifFile->ExtensionBlockCount,
+	      /* (zero length extensions come back as NULL, nothing to add) */
+	      if (ExtData != NULL &&
+		  GifAddExtensionBlock(&GifFile->ExtensionBlockCount,
 				       &GifFile->ExtensionBlocks, 
 				       ExtFunction, ExtData[0], &ExtData[1])
 		  == GIF_ERROR)